@@ -4,13 +4,15 @@
 #include <string>
 #include <vector>
 #include <set>
+#include <ctime>
+#include <cstdint>
 
 struct BorrowRecord {
     int bookId;
-    std::string borrowDate;
-    std::string dueDate;
+    time_t borrowDate;
+    time_t dueDate;
     bool returned;
-    double fine;
+    double fine;  // charged to the account so far
 };
 
 class Account {
@@ -25,7 +27,7 @@ public:
     Account(const std::string& id) : userId(id), totalFine(0.0), finePaid(true) {}
 
     // Getters
-    std::string getUserId() const { return userId; }
+    const std::string& getUserId() const { return userId; }
     double getTotalFine() const { return totalFine; }
     bool isFinePaid() const { return finePaid; }
     const std::set<int>& getCurrentlyBorrowedBooks() const { return currentlyBorrowedBooks; }
@@ -41,15 +43,37 @@ public:
         }
     }
 
-    // Book management
-    void addBorrowedBook(int bookId, const std::string& borrowDate, const std::string& dueDate) {
+    // Book management; returns the index of the new record in the history
+    size_t addBorrowedBook(int bookId, time_t borrowDate, time_t dueDate) {
         currentlyBorrowedBooks.insert(bookId);
         BorrowRecord record{bookId, borrowDate, dueDate, false, 0.0};
         borrowHistory.push_back(record);
+        return borrowHistory.size() - 1;
     }
 
     void removeBorrowedBook(int bookId) {
         currentlyBorrowedBooks.erase(bookId);
+        size_t record = findActiveLoan(bookId);
+        if (record != SIZE_MAX) borrowHistory[record].returned = true;
+    }
+
+    // History index of the unreturned loan of `bookId`, or SIZE_MAX
+    size_t findActiveLoan(int bookId) const {
+        for (size_t i = borrowHistory.size(); i > 0; --i) {
+            const BorrowRecord& record = borrowHistory[i - 1];
+            if (record.bookId == bookId && !record.returned) return i - 1;
+        }
+        return SIZE_MAX;
+    }
+
+    // Raises the fine charged on a loan to `fine`, adding the difference
+    // to the total
+    void chargeFine(size_t record, double fine) {
+        BorrowRecord& loan = borrowHistory[record];
+        if (fine <= loan.fine) return;
+        totalFine += fine - loan.fine;
+        loan.fine = fine;
+        finePaid = false;
     }
 
     void addToHistory(const BorrowRecord& record) {
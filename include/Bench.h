@@ -0,0 +1,62 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <string>
+#include <vector>
+#include <ostream>
+
+struct BenchConfig {
+    std::vector<std::string> suites;  // empty for all of them
+    int rows = 1000000;               // generated books; users are a tenth of that
+    int repeat = 3;                   // each case reports its fastest run
+    unsigned seed = 1;
+};
+
+// Microbenchmarks of the data paths that replaced simpler code. Each suite
+// times the current implementation against the code it replaced, kept here
+// as the baseline, on generated data, and checks that both produced the same
+// result.
+//
+//   parse   the books.txt and users.txt tokenizer (FieldParser.h) against
+//           the istringstream + std::stoi loaders
+//   books   BookStore against the vector + std::map<int, Book*> it replaced
+//   scan    ScanEngine, on each kernel the CPU supports, against folding
+//           and searching every book's fields in turn
+//   fines   calculateFinesBatch over the loan table against calculateFines
+//           and its due-time queue, on libraries with a VirtualClock
+class Bench {
+public:
+    explicit Bench(const BenchConfig& config);
+
+    // Runs the selected suites; false if a suite is unknown or two
+    // implementations disagreed
+    bool run(std::ostream& out);
+
+private:
+    struct Suite {
+        const char* name;
+        void (Bench::*run)();
+    };
+    static const Suite kSuites[];
+
+    struct Row {
+        std::string name;
+        double baselineMs;
+        double currentMs;
+        bool agreed;
+    };
+
+    BenchConfig config;
+    std::vector<Row> rows;
+
+    void parse();
+    void bookStore();
+    void scan();
+    void fines();
+
+    template <typename Run, typename Cleanup>
+    double bestOf(Run run, Cleanup cleanup) const;
+    void report(std::ostream& out, const char* suite) const;
+};
+
+#endif
@@ -0,0 +1,279 @@
+#ifndef BITMAP_H
+#define BITMAP_H
+
+#include <vector>
+#include <algorithm>
+#include <iterator>
+#include <cstdint>
+#include <cstddef>
+
+// Compressed set of 32-bit ids in the style of Roaring bitmaps. Ids are
+// split by their high 16 bits into containers; a container holds its low
+// halves as a sorted array while it has at most 4096 of them, and as a
+// 65536-bit bitset (8 KB) beyond that. Sparse sets cost two bytes per id,
+// dense ones at most one bit, and AND/OR/AND NOT work a container at a
+// time, a word at a time for bitsets.
+class Bitmap {
+private:
+    static constexpr size_t kArrayMax = 4096;
+    static constexpr size_t kWords = 1024;
+
+    struct Container {
+        uint16_t key;
+        uint32_t cardinality;
+        std::vector<uint16_t> array;  // sorted, used while bits is empty
+        std::vector<uint64_t> bits;   // kWords words once dense
+
+        bool isBitset() const { return !bits.empty(); }
+
+        bool contains(uint16_t low) const {
+            if (isBitset()) return (bits[low >> 6] >> (low & 63)) & 1;
+            return std::binary_search(array.begin(), array.end(), low);
+        }
+
+        void toBitset() {
+            bits.assign(kWords, 0);
+            for (uint16_t low : array) bits[low >> 6] |= uint64_t(1) << (low & 63);
+            array.clear();
+            array.shrink_to_fit();
+        }
+
+        void toArray() {
+            array.clear();
+            array.reserve(cardinality);
+            forEach([this](uint16_t low) { array.push_back(low); return true; });
+            bits.clear();
+            bits.shrink_to_fit();
+        }
+
+        // Picks the cheaper form for the current cardinality
+        void normalize() {
+            if (isBitset() && cardinality <= kArrayMax) toArray();
+            else if (!isBitset() && cardinality > kArrayMax) toBitset();
+        }
+
+        void recount() {
+            cardinality = 0;
+            for (uint64_t word : bits) cardinality += static_cast<uint32_t>(__builtin_popcountll(word));
+        }
+
+        // Calls f(low) in ascending order until it returns false
+        template <typename F>
+        bool forEach(F f) const {
+            if (!isBitset()) {
+                for (uint16_t low : array) {
+                    if (!f(low)) return false;
+                }
+                return true;
+            }
+            for (size_t w = 0; w < kWords; ++w) {
+                for (uint64_t word = bits[w]; word; word &= word - 1) {
+                    if (!f(static_cast<uint16_t>(w * 64 + static_cast<size_t>(__builtin_ctzll(word))))) return false;
+                }
+            }
+            return true;
+        }
+    };
+
+    std::vector<Container> containers;  // sorted by key, none empty
+
+    static uint16_t high(uint32_t id) { return static_cast<uint16_t>(id >> 16); }
+    static uint16_t low(uint32_t id) { return static_cast<uint16_t>(id & 0xFFFF); }
+
+    std::vector<Container>::iterator findContainer(uint16_t key) {
+        return std::lower_bound(containers.begin(), containers.end(), key,
+                                [](const Container& c, uint16_t k) { return c.key < k; });
+    }
+
+    std::vector<Container>::const_iterator findContainer(uint16_t key) const {
+        return std::lower_bound(containers.begin(), containers.end(), key,
+                                [](const Container& c, uint16_t k) { return c.key < k; });
+    }
+
+    static Container intersect(const Container& a, const Container& b) {
+        Container out{a.key, 0, {}, {}};
+        if (a.isBitset() && b.isBitset()) {
+            out.bits.resize(kWords);
+            for (size_t w = 0; w < kWords; ++w) out.bits[w] = a.bits[w] & b.bits[w];
+            out.recount();
+        } else if (a.isBitset() || b.isBitset()) {
+            const Container& sparse = a.isBitset() ? b : a;
+            const Container& dense = a.isBitset() ? a : b;
+            for (uint16_t low : sparse.array) {
+                if (dense.contains(low)) out.array.push_back(low);
+            }
+            out.cardinality = static_cast<uint32_t>(out.array.size());
+        } else {
+            std::set_intersection(a.array.begin(), a.array.end(), b.array.begin(), b.array.end(),
+                                  std::back_inserter(out.array));
+            out.cardinality = static_cast<uint32_t>(out.array.size());
+        }
+        out.normalize();
+        return out;
+    }
+
+    static Container unite(const Container& a, const Container& b) {
+        Container out{a.key, 0, {}, {}};
+        if (a.isBitset() || b.isBitset()) {
+            out = a.isBitset() ? a : b;
+            const Container& other = a.isBitset() ? b : a;
+            if (other.isBitset()) {
+                for (size_t w = 0; w < kWords; ++w) out.bits[w] |= other.bits[w];
+            } else {
+                for (uint16_t low : other.array) out.bits[low >> 6] |= uint64_t(1) << (low & 63);
+            }
+            out.recount();
+        } else {
+            std::set_union(a.array.begin(), a.array.end(), b.array.begin(), b.array.end(),
+                           std::back_inserter(out.array));
+            out.cardinality = static_cast<uint32_t>(out.array.size());
+        }
+        out.normalize();
+        return out;
+    }
+
+    static Container subtract(const Container& a, const Container& b) {
+        Container out{a.key, 0, {}, {}};
+        if (!a.isBitset()) {
+            for (uint16_t low : a.array) {
+                if (!b.contains(low)) out.array.push_back(low);
+            }
+            out.cardinality = static_cast<uint32_t>(out.array.size());
+        } else {
+            out.bits = a.bits;
+            if (b.isBitset()) {
+                for (size_t w = 0; w < kWords; ++w) out.bits[w] &= ~b.bits[w];
+            } else {
+                for (uint16_t low : b.array) out.bits[low >> 6] &= ~(uint64_t(1) << (low & 63));
+            }
+            out.recount();
+        }
+        out.normalize();
+        return out;
+    }
+
+public:
+    void add(uint32_t id) {
+        auto it = findContainer(high(id));
+        if (it == containers.end() || it->key != high(id)) {
+            it = containers.insert(it, Container{high(id), 0, {}, {}});
+        }
+        uint16_t value = low(id);
+        if (it->isBitset()) {
+            uint64_t& word = it->bits[value >> 6];
+            uint64_t bit = uint64_t(1) << (value & 63);
+            if (word & bit) return;
+            word |= bit;
+        } else {
+            // Ids usually arrive in ascending order, making this an append
+            auto pos = (it->array.empty() || it->array.back() < value)
+                           ? it->array.end()
+                           : std::lower_bound(it->array.begin(), it->array.end(), value);
+            if (pos != it->array.end() && *pos == value) return;
+            it->array.insert(pos, value);
+        }
+        ++it->cardinality;
+        it->normalize();
+    }
+
+    void remove(uint32_t id) {
+        auto it = findContainer(high(id));
+        if (it == containers.end() || it->key != high(id)) return;
+        uint16_t value = low(id);
+        if (it->isBitset()) {
+            uint64_t& word = it->bits[value >> 6];
+            uint64_t bit = uint64_t(1) << (value & 63);
+            if (!(word & bit)) return;
+            word &= ~bit;
+        } else {
+            auto pos = std::lower_bound(it->array.begin(), it->array.end(), value);
+            if (pos == it->array.end() || *pos != value) return;
+            it->array.erase(pos);
+        }
+        if (--it->cardinality == 0) {
+            containers.erase(it);
+        } else {
+            it->normalize();
+        }
+    }
+
+    bool contains(uint32_t id) const {
+        auto it = findContainer(high(id));
+        return it != containers.end() && it->key == high(id) && it->contains(low(id));
+    }
+
+    size_t cardinality() const {
+        size_t total = 0;
+        for (const Container& c : containers) total += c.cardinality;
+        return total;
+    }
+
+    bool empty() const { return containers.empty(); }
+    void clear() { containers.clear(); }
+
+    Bitmap operator&(const Bitmap& other) const {
+        Bitmap result;
+        auto a = containers.begin();
+        auto b = other.containers.begin();
+        while (a != containers.end() && b != other.containers.end()) {
+            if (a->key < b->key) {
+                ++a;
+            } else if (b->key < a->key) {
+                ++b;
+            } else {
+                Container c = intersect(*a, *b);
+                if (c.cardinality > 0) result.containers.push_back(std::move(c));
+                ++a;
+                ++b;
+            }
+        }
+        return result;
+    }
+
+    Bitmap operator|(const Bitmap& other) const {
+        Bitmap result;
+        auto a = containers.begin();
+        auto b = other.containers.begin();
+        while (a != containers.end() || b != other.containers.end()) {
+            if (b == other.containers.end() || (a != containers.end() && a->key < b->key)) {
+                result.containers.push_back(*a++);
+            } else if (a == containers.end() || b->key < a->key) {
+                result.containers.push_back(*b++);
+            } else {
+                result.containers.push_back(unite(*a++, *b++));
+            }
+        }
+        return result;
+    }
+
+    // Ids in this set but not in `other` (AND NOT)
+    Bitmap operator-(const Bitmap& other) const {
+        Bitmap result;
+        auto b = other.containers.begin();
+        for (const Container& a : containers) {
+            while (b != other.containers.end() && b->key < a.key) ++b;
+            if (b == other.containers.end() || b->key != a.key) {
+                result.containers.push_back(a);
+                continue;
+            }
+            Container c = subtract(a, *b);
+            if (c.cardinality > 0) result.containers.push_back(std::move(c));
+        }
+        return result;
+    }
+
+    Bitmap& operator&=(const Bitmap& other) { return *this = *this & other; }
+    Bitmap& operator|=(const Bitmap& other) { return *this = *this | other; }
+    Bitmap& operator-=(const Bitmap& other) { return *this = *this - other; }
+
+    // Calls f(id) in ascending order until it returns false
+    template <typename F>
+    void forEach(F f) const {
+        for (const Container& c : containers) {
+            uint32_t base = static_cast<uint32_t>(c.key) << 16;
+            if (!c.forEach([&f, base](uint16_t low) { return f(base | low); })) return;
+        }
+    }
+};
+
+#endif
@@ -1,20 +1,26 @@
 #ifndef BOOK_H
 #define BOOK_H
 
+#include "Policy.h"
 #include <string>
-#include <queue>
+#include <string_view>
+#include <list>
+#include <unordered_map>
+#include <vector>
 #include <ctime>
 
 struct Reservation {
     std::string userId;
     time_t reservationDate;
     time_t notificationDate;  // When the book became available
+    time_t holdExpiry;        // When the notified user's hold lapses
     bool notified;           // Whether user has been notified
     
-    Reservation(const std::string& id) : 
+    Reservation(const std::string& id, time_t now) : 
         userId(id), 
-        reservationDate(time(nullptr)),
+        reservationDate(now),
         notificationDate(0),
+        holdExpiry(0),
         notified(false) {}
 };
 
@@ -26,64 +32,65 @@ private:
     std::string publisher;
     int year;
     std::string isbn;
-    std::string status;  // "Available", "Borrowed", or "Reserved"
+    BookStatus status;
     std::string borrowedBy;  // UserID of the borrower
-    std::queue<Reservation> reservationQueue;  // Queue of reservations
+    // FIFO queue of reservations, plus each user's position in it so that
+    // membership tests and cancellation are O(1)
+    std::list<Reservation> reservationQueue;
+    std::unordered_map<std::string, std::list<Reservation>::iterator> reservationIndex;
 
 public:
+    // How long a notified patron has to borrow the book
+    static constexpr int kHoldDays = 3;
+
     Book(int id, const std::string& title, const std::string& author,
          const std::string& publisher, int year, const std::string& isbn)
         : bookId(id), title(title), author(author), publisher(publisher),
-          year(year), isbn(isbn), status("Available"), borrowedBy("") {}
+          year(year), isbn(isbn), status(BookStatus::Available), borrowedBy("") {}
+
+    // The reservation index points into this book's own queue
+    Book(const Book&) = delete;
+    Book& operator=(const Book&) = delete;
 
     // Getters
     int getBookId() const { return bookId; }
-    std::string getTitle() const { return title; }
-    std::string getAuthor() const { return author; }
-    std::string getPublisher() const { return publisher; }
+    const std::string& getTitle() const { return title; }
+    const std::string& getAuthor() const { return author; }
+    const std::string& getPublisher() const { return publisher; }
     int getYear() const { return year; }
-    std::string getIsbn() const { return isbn; }
-    std::string getStatus() const { return status; }
-    std::string getBorrowedBy() const { return borrowedBy; }
+    const std::string& getIsbn() const { return isbn; }
+    BookStatus getStatusCode() const { return status; }
+    std::string_view getStatus() const { return toString(status); }
+    const std::string& getBorrowedBy() const { return borrowedBy; }
 
     // Reservation methods
-    bool reserve(const std::string& userId) {
-        if (status == "Available" || hasReservation(userId)) {
+    bool reserve(const std::string& userId, time_t now) {
+        if (status == BookStatus::Available || hasReservation(userId)) {
             return false;
         }
-        reservationQueue.push(Reservation(userId));
+        reservationQueue.push_back(Reservation(userId, now));
+        reservationIndex[userId] = std::prev(reservationQueue.end());
         return true;
     }
 
     bool cancelReservation(const std::string& userId) {
-        if (reservationQueue.empty()) return false;
-        
-        // Since we can't easily remove from a queue, we'll create a new queue
-        std::queue<Reservation> newQueue;
-        bool found = false;
-        
-        while (!reservationQueue.empty()) {
-            Reservation res = reservationQueue.front();
-            reservationQueue.pop();
-            
-            if (res.userId != userId) {
-                newQueue.push(res);
-            } else {
-                found = true;
-            }
-        }
-        
-        reservationQueue = newQueue;
-        return found;
+        auto it = reservationIndex.find(userId);
+        if (it == reservationIndex.end()) return false;
+        reservationQueue.erase(it->second);
+        reservationIndex.erase(it);
+        return true;
     }
 
     bool hasReservation(const std::string& userId) const {
-        std::queue<Reservation> temp = reservationQueue;
-        while (!temp.empty()) {
-            if (temp.front().userId == userId) return true;
-            temp.pop();
-        }
-        return false;
+        return reservationIndex.count(userId) > 0;
+    }
+
+    size_t getReservationCount() const { return reservationQueue.size(); }
+
+    std::vector<std::string> getReservedUserIds() const {
+        std::vector<std::string> userIds;
+        for (const Reservation& res : reservationQueue) userIds.push_back(res.userId);
+        return userIds;
     }
 
     std::string getNextReservation() const {
@@ -91,26 +98,34 @@ public:
         return reservationQueue.front().userId;
     }
 
-    void notifyNextInQueue() {
+    // Starts the hold of the user at the head of the queue
+    void notifyNextInQueue(time_t now, time_t holdSeconds) {
         if (!reservationQueue.empty()) {
             Reservation& res = reservationQueue.front();
-            res.notificationDate = time(nullptr);
+            res.notificationDate = now;
+            res.holdExpiry = now + holdSeconds;
             res.notified = true;
         }
     }
 
-    bool isReservationExpired() const {
+    // When the hold of the notified patron at the head of the queue lapses,
+    // or 0 if nobody has been notified
+    time_t getHoldExpiry() const {
         if (reservationQueue.empty() || !reservationQueue.front().notified) {
-            return false;
+            return 0;
         }
-        
-        time_t now = time(nullptr);
-        return (now - reservationQueue.front().notificationDate) > (3 * 10); // 3 days (10 seconds = 1 day for testing)
+        return reservationQueue.front().holdExpiry;
+    }
+
+    bool isReservationExpired(time_t now) const {
+        time_t expiry = getHoldExpiry();
+        return expiry != 0 && now > expiry;
     }
 
-    void removeExpiredReservation() {
-        if (!reservationQueue.empty() && isReservationExpired()) {
-            reservationQueue.pop();
+    void removeExpiredReservation(time_t now) {
+        if (!reservationQueue.empty() && isReservationExpired(now)) {
+            reservationIndex.erase(reservationQueue.front().userId);
+            reservationQueue.pop_front();
         }
     }
 
@@ -120,21 +135,19 @@ public:
     void setPublisher(const std::string& p) { publisher = p; }
     void setYear(int y) { year = y; }
     void setIsbn(const std::string& i) { isbn = i; }
-    void setStatus(const std::string& s) { status = s; }
+    void setStatus(BookStatus s) { status = s; }
     void setBorrowedBy(const std::string& userId) { borrowedBy = userId; }
 
     // Other methods
-    bool isAvailable() const { return status == "Available"; }
+    bool isAvailable() const { return status == BookStatus::Available; }
     void markAsBorrowed(const std::string& userId) {
-        status = "Borrowed";
+        status = BookStatus::Borrowed;
         borrowedBy = userId;
     }
+    // The next patron in the queue, if any, is notified by the library
     void markAsReturned() {
-        status = "Available";
+        status = BookStatus::Available;
         borrowedBy = "";
-        if (!reservationQueue.empty()) {
-            notifyNextInQueue();
-        }
     }
 };
 
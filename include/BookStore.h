@@ -0,0 +1,158 @@
+#ifndef BOOK_STORE_H
+#define BOOK_STORE_H
+
+#include "Book.h"
+#include <vector>
+#include <atomic>
+#include <memory>
+#include <cstddef>
+#include <iterator>
+
+// Slab of books indexed directly by book id. Book ids are handed out densely
+// (max + 1), so slot `id` holds the book with that id and removed books leave
+// a null tombstone. Lookup and removal are O(1); iteration walks the slots
+// in id order, skipping tombstones.
+//
+// Slots live in fixed-size chunks that never move once allocated, and every
+// slot and chunk pointer is atomic, so get() takes no lock and is safe while
+// another thread inserts or removes. Writers must still be serialized by the
+// caller.
+class BookStore {
+public:
+    // Ids beyond this are rejected rather than growing the slab unboundedly
+    static const int kMaxBookId = 1 << 26;
+
+private:
+    static constexpr int kChunkBits = 12;
+    static constexpr size_t kChunkSize = size_t(1) << kChunkBits;
+    static constexpr size_t kChunkCount = (static_cast<size_t>(kMaxBookId) >> kChunkBits) + 1;
+
+    using Chunk = std::atomic<Book*>;
+    std::unique_ptr<std::atomic<Chunk*>[]> chunks;  // kChunkCount entries
+    size_t liveCount;
+    int maxId;  // highest live id, 0 when empty
+
+    Chunk* chunkFor(int bookId) {
+        std::atomic<Chunk*>& entry = chunks[static_cast<size_t>(bookId) >> kChunkBits];
+        Chunk* chunk = entry.load(std::memory_order_relaxed);
+        if (!chunk) {
+            chunk = new Chunk[kChunkSize];
+            for (size_t i = 0; i < kChunkSize; ++i) chunk[i].store(nullptr, std::memory_order_relaxed);
+            entry.store(chunk, std::memory_order_release);
+        }
+        return chunk;
+    }
+
+public:
+    // Steps through the slots of one chunk at a time instead of looking
+    // every id up from the top
+    class const_iterator {
+    private:
+        const BookStore* store;
+        int index;
+        int last;            // highest id when the iteration started
+        const Chunk* chunk;  // the chunk holding `index`, once loaded
+
+        void skipTombstones() {
+            while (index <= last) {
+                if (!chunk) chunk = store->chunks[static_cast<size_t>(index) >> kChunkBits].load(std::memory_order_acquire);
+                if (!chunk) {
+                    index = (index | static_cast<int>(kChunkSize - 1)) + 1;  // no chunk, so no books in it
+                    continue;
+                }
+                if (chunk[static_cast<size_t>(index) & (kChunkSize - 1)].load(std::memory_order_acquire)) return;
+                advance();
+            }
+            index = last + 1;  // where end() stops, even after skipping a whole chunk
+        }
+
+        void advance() {
+            ++index;
+            if ((static_cast<size_t>(index) & (kChunkSize - 1)) == 0) chunk = nullptr;
+        }
+
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = Book*;
+        using difference_type = std::ptrdiff_t;
+        using pointer = Book* const*;
+        using reference = Book* const&;
+
+        const_iterator(const BookStore* store, int index)
+            : store(store), index(index), last(store->maxId), chunk(nullptr) {
+            skipTombstones();
+        }
+
+        Book* operator*() const {
+            return chunk[static_cast<size_t>(index) & (kChunkSize - 1)].load(std::memory_order_acquire);
+        }
+        const_iterator& operator++() {
+            advance();
+            skipTombstones();
+            return *this;
+        }
+        // Past its own last id an iterator equals end(), even if a book was
+        // added between the calls to begin() and end()
+        bool operator==(const const_iterator& other) const {
+            return index == other.index || (index > last && other.index > other.last);
+        }
+        bool operator!=(const const_iterator& other) const { return !(*this == other); }
+    };
+
+    BookStore() : chunks(new std::atomic<Chunk*>[kChunkCount]), liveCount(0), maxId(0) {
+        for (size_t i = 0; i < kChunkCount; ++i) chunks[i].store(nullptr, std::memory_order_relaxed);
+    }
+
+    ~BookStore() {
+        for (size_t i = 0; i < kChunkCount; ++i) delete[] chunks[i].load(std::memory_order_relaxed);
+    }
+
+    BookStore(const BookStore&) = delete;
+    BookStore& operator=(const BookStore&) = delete;
+
+    Book* get(int bookId) const {
+        if (bookId < 0 || bookId > kMaxBookId) return nullptr;
+        const Chunk* chunk = chunks[static_cast<size_t>(bookId) >> kChunkBits].load(std::memory_order_acquire);
+        if (!chunk) return nullptr;
+        return chunk[static_cast<size_t>(bookId) & (kChunkSize - 1)].load(std::memory_order_acquire);
+    }
+
+    // Fails if the id is out of range or already taken
+    bool insert(Book* book) {
+        int bookId = book->getBookId();
+        if (bookId < 0 || bookId > kMaxBookId) return false;
+        Chunk& slot = chunkFor(bookId)[static_cast<size_t>(bookId) & (kChunkSize - 1)];
+        if (slot.load(std::memory_order_relaxed)) return false;
+        slot.store(book, std::memory_order_release);
+        ++liveCount;
+        if (bookId > maxId) maxId = bookId;
+        return true;
+    }
+
+    // Leaves a tombstone and hands the book back to the caller
+    Book* remove(int bookId) {
+        Book* book = get(bookId);
+        if (!book) return nullptr;
+        chunkFor(bookId)[static_cast<size_t>(bookId) & (kChunkSize - 1)].store(nullptr, std::memory_order_release);
+        --liveCount;
+        while (maxId > 0 && get(maxId) == nullptr) --maxId;
+        return book;
+    }
+
+    // Allocates the chunks for ids up to `highestId` ahead of a bulk load
+    void reserve(int highestId) {
+        if (highestId < 0 || highestId > kMaxBookId) return;
+        for (int bookId = 0; bookId <= highestId; bookId += static_cast<int>(kChunkSize)) chunkFor(bookId);
+    }
+
+    size_t size() const { return liveCount; }
+    bool empty() const { return liveCount == 0; }
+    int nextId() const { return maxId + 1; }
+
+    const_iterator begin() const { return const_iterator(this, 0); }
+    const_iterator end() const { return const_iterator(this, maxId + 1); }
+
+    std::vector<Book*> toVector() const { return std::vector<Book*>(begin(), end()); }
+};
+
+#endif
@@ -0,0 +1,120 @@
+#ifndef CATALOG_INDEX_H
+#define CATALOG_INDEX_H
+
+#include "Book.h"
+#include "Bitmap.h"
+#include "TextUtil.h"
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <map>
+#include <climits>
+
+// Conditions a book must all meet; unset ones match every book
+struct BookFilter {
+    bool anyStatus = true;
+    BookStatus status = BookStatus::Available;
+    std::string publisher;  // compared case-insensitively; empty for any
+    int fromYear = INT_MIN;
+    int toYear = INT_MAX;
+};
+
+// Bitmap indexes of book ids by status, publisher and year, so filters and
+// reports over those fields combine a few bitmaps instead of walking every
+// book. Publishers are keyed by their normalized name and years get one
+// bitmap each; a year range ORs the years it covers.
+class CatalogIndex {
+private:
+    struct PublisherBooks {
+        std::string name;  // as first seen, for reports
+        Bitmap books;
+    };
+
+    Bitmap allBooks;
+    Bitmap byStatus[3];
+    std::unordered_map<std::string, PublisherBooks> byPublisher;
+    std::map<int, Bitmap> byYear;
+
+    static uint32_t idOf(const Book& book) {
+        return static_cast<uint32_t>(book.getBookId());
+    }
+
+public:
+    void add(const Book& book) {
+        allBooks.add(idOf(book));
+        byStatus[static_cast<int>(book.getStatusCode())].add(idOf(book));
+        PublisherBooks& publisher = byPublisher[normalizeText(book.getPublisher())];
+        if (publisher.books.empty()) publisher.name = book.getPublisher();
+        publisher.books.add(idOf(book));
+        byYear[book.getYear()].add(idOf(book));
+    }
+
+    // Must see the status, publisher and year the book was added with
+    void remove(const Book& book) {
+        allBooks.remove(idOf(book));
+        byStatus[static_cast<int>(book.getStatusCode())].remove(idOf(book));
+        auto publisher = byPublisher.find(normalizeText(book.getPublisher()));
+        if (publisher != byPublisher.end()) {
+            publisher->second.books.remove(idOf(book));
+            if (publisher->second.books.empty()) byPublisher.erase(publisher);
+        }
+        auto year = byYear.find(book.getYear());
+        if (year != byYear.end()) {
+            year->second.remove(idOf(book));
+            if (year->second.empty()) byYear.erase(year);
+        }
+    }
+
+    void setStatus(int bookId, BookStatus from, BookStatus to) {
+        byStatus[static_cast<int>(from)].remove(static_cast<uint32_t>(bookId));
+        byStatus[static_cast<int>(to)].add(static_cast<uint32_t>(bookId));
+    }
+
+    void clear() {
+        allBooks.clear();
+        for (Bitmap& books : byStatus) books.clear();
+        byPublisher.clear();
+        byYear.clear();
+    }
+
+    const Bitmap& all() const { return allBooks; }
+
+    const Bitmap& withStatus(BookStatus status) const {
+        return byStatus[static_cast<int>(status)];
+    }
+
+    Bitmap withPublisher(std::string_view publisher) const {
+        auto it = byPublisher.find(normalizeText(publisher));
+        return it != byPublisher.end() ? it->second.books : Bitmap();
+    }
+
+    Bitmap inYears(int fromYear, int toYear) const {
+        Bitmap books;
+        for (auto it = byYear.lower_bound(fromYear); it != byYear.end() && it->first <= toYear; ++it) {
+            books |= it->second;
+        }
+        return books;
+    }
+
+    Bitmap match(const BookFilter& filter) const {
+        Bitmap books = filter.anyStatus ? allBooks : withStatus(filter.status);
+        if (!filter.publisher.empty()) books &= withPublisher(filter.publisher);
+        if (filter.fromYear != INT_MIN || filter.toYear != INT_MAX) {
+            books &= inYears(filter.fromYear, filter.toYear);
+        }
+        return books;
+    }
+
+    // Publisher display names with their bitmaps, for per-publisher reports
+    template <typename F>
+    void forEachPublisher(F f) const {
+        for (const auto& entry : byPublisher) f(entry.second.name, entry.second.books);
+    }
+
+    template <typename F>
+    void forEachYear(F f) const {
+        for (const auto& entry : byYear) f(entry.first, entry.second);
+    }
+};
+
+#endif
@@ -0,0 +1,349 @@
+#ifndef CATALOG_SNAPSHOT_H
+#define CATALOG_SNAPSHOT_H
+
+#include "Book.h"
+#include "Epoch.h"
+#include <string>
+#include <string_view>
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <mutex>
+#include <unordered_map>
+#include <functional>
+#include <algorithm>
+#include <cstdint>
+#include <cstddef>
+
+// Catalog fields of one book as published in a snapshot; never changed
+// once published. The text fields share one allocation, since every book
+// in the catalog has a view.
+class BookView {
+private:
+    int bookId;
+    int year;
+    BookStatus status;
+    uint32_t lengths[4];         // of the title, author, publisher and ISBN
+    std::unique_ptr<char[]> text;  // the four fields back to back
+    std::string borrowedBy;
+    std::vector<std::string> reservations;  // user ids, head of the queue first
+
+    std::string_view field(int index) const {
+        size_t offset = 0;
+        for (int i = 0; i < index; ++i) offset += lengths[i];
+        return std::string_view(text.get() + offset, lengths[index]);
+    }
+
+public:
+    explicit BookView(const Book& book)
+        : bookId(book.getBookId()), year(book.getYear()), status(book.getStatusCode()),
+          borrowedBy(book.getBorrowedBy()), reservations(book.getReservedUserIds()) {
+        const std::string* fields[4] = {&book.getTitle(), &book.getAuthor(), &book.getPublisher(), &book.getIsbn()};
+        size_t total = 0;
+        for (int i = 0; i < 4; ++i) {
+            lengths[i] = static_cast<uint32_t>(fields[i]->size());
+            total += lengths[i];
+        }
+        text.reset(new char[total]);
+        char* out = text.get();
+        for (const std::string* value : fields) out = std::copy(value->begin(), value->end(), out);
+    }
+
+    int getBookId() const { return bookId; }
+    std::string_view getTitle() const { return field(0); }
+    std::string_view getAuthor() const { return field(1); }
+    std::string_view getPublisher() const { return field(2); }
+    int getYear() const { return year; }
+    std::string_view getIsbn() const { return field(3); }
+    BookStatus getStatusCode() const { return status; }
+    std::string_view getStatus() const { return toString(status); }
+    const std::string& getBorrowedBy() const { return borrowedBy; }
+    const std::vector<std::string>& getReservedUserIds() const { return reservations; }
+
+    bool isAvailable() const { return status == BookStatus::Available; }
+    bool hasReservation(const std::string& userId) const {
+        return std::find(reservations.begin(), reservations.end(), userId) != reservations.end();
+    }
+};
+
+// One immutable version of the catalog: every book's view by id, and the
+// books each user has reserved. Versions share all the parts they have in
+// common; both maps are radix trees over 28-bit keys whose nodes are never
+// changed once published.
+class CatalogSnapshot {
+public:
+    static constexpr int kBits = 7;
+    static constexpr int kLevels = 4;
+    static constexpr size_t kFanout = size_t(1) << kBits;
+    static constexpr uint32_t kReservationBuckets = 1 << 16;
+
+    // Child nodes, or values at the last level
+    struct Node {
+        const void* slots[kFanout] = {};
+        uint64_t version = 0;  // of the snapshot that created the node
+    };
+
+    // Reservations of the users whose ids hash to one bucket
+    struct ReservationBucket {
+        std::vector<std::pair<std::string, std::vector<int>>> users;  // book ids sorted
+    };
+
+    uint64_t version;
+    size_t bookCount;
+    const Node* books;
+    const Node* reservations;
+
+    static size_t slotIndex(uint32_t key, int level) {
+        return (key >> (level * kBits)) & (kFanout - 1);
+    }
+
+    // Whether a book id is within the key range
+    static bool fits(int bookId) {
+        return bookId >= 0 && (static_cast<uint32_t>(bookId) >> (kBits * kLevels)) == 0;
+    }
+
+    static uint32_t bucketKey(const std::string& userId) {
+        return static_cast<uint32_t>(std::hash<std::string>()(userId) % kReservationBuckets);
+    }
+
+    static const void* find(const Node* root, uint32_t key) {
+        const Node* node = root;
+        for (int level = kLevels - 1; level > 0 && node; --level) {
+            node = static_cast<const Node*>(node->slots[slotIndex(key, level)]);
+        }
+        return node ? node->slots[slotIndex(key, 0)] : nullptr;
+    }
+
+    const BookView* book(int bookId) const {
+        if (!fits(bookId)) return nullptr;
+        return static_cast<const BookView*>(find(books, static_cast<uint32_t>(bookId)));
+    }
+
+    // Ids of the books `userId` has reserved, in id order
+    std::vector<int> reservedBooks(const std::string& userId) const {
+        const auto* bucket = static_cast<const ReservationBucket*>(find(reservations, bucketKey(userId)));
+        if (bucket) {
+            for (const auto& entry : bucket->users) {
+                if (entry.first == userId) return entry.second;
+            }
+        }
+        return {};
+    }
+
+    // Calls f(view) for every book, in id order
+    template <typename F>
+    void forEachBook(F f) const {
+        forEachValue(books, kLevels - 1, [&f](const void* value) { f(*static_cast<const BookView*>(value)); });
+    }
+
+    template <typename F>
+    static void forEachValue(const Node* node, int level, F&& f) {
+        if (!node) return;
+        for (const void* slot : node->slots) {
+            if (!slot) continue;
+            if (level == 0) {
+                f(slot);
+            } else {
+                forEachValue(static_cast<const Node*>(slot), level - 1, f);
+            }
+        }
+    }
+
+    static void forEachNode(const Node* node, int level, const std::function<void(const Node*, int)>& f) {
+        if (!node) return;
+        if (level > 0) {
+            for (const void* slot : node->slots) forEachNode(static_cast<const Node*>(slot), level - 1, f);
+        }
+        f(node, level);
+    }
+};
+
+// The current catalog snapshot, read without locks. Readers pin an epoch and
+// use whichever version was current then, unaffected by later changes.
+// Writers, one at a time, copy the tree paths they change into a new
+// version, publish it with one atomic store and retire what it replaced.
+class PublishedCatalog {
+private:
+    mutable EpochDomain epochs;
+    std::atomic<const CatalogSnapshot*> current;
+    std::mutex writerMutex;
+
+public:
+    // A pinned version; the views it returns stay valid while it lives
+    class Reader {
+    private:
+        EpochDomain::Guard guard;
+        const CatalogSnapshot* snapshot;
+
+    public:
+        explicit Reader(const PublishedCatalog& catalog)
+            : guard(catalog.epochs), snapshot(catalog.current.load(std::memory_order_seq_cst)) {}
+        Reader(const Reader&) = delete;
+        Reader& operator=(const Reader&) = delete;
+
+        uint64_t version() const { return snapshot->version; }
+        size_t size() const { return snapshot->bookCount; }
+        const BookView* book(int bookId) const { return snapshot->book(bookId); }
+        std::vector<int> reservedBooks(const std::string& userId) const { return snapshot->reservedBooks(userId); }
+
+        template <typename F>
+        void forEachBook(F f) const { snapshot->forEachBook(f); }
+    };
+
+    // Changes to the next version, published as one when the update ends.
+    // Nodes this update created are changed in place; published ones are
+    // copied once and retired after the new version is visible.
+    class Update {
+    private:
+        using Node = CatalogSnapshot::Node;
+        using ReservationBucket = CatalogSnapshot::ReservationBucket;
+
+        PublishedCatalog& catalog;
+        std::lock_guard<std::mutex> lock;
+        const CatalogSnapshot* base;
+        Node* books;
+        Node* reservations;
+        size_t bookCount;
+        bool changed;
+        std::vector<const Node*> replacedNodes;
+        std::vector<const BookView*> replacedViews;
+        std::vector<const ReservationBucket*> replacedBuckets;
+        std::unordered_map<uint32_t, std::unique_ptr<ReservationBucket>> buckets;  // copies being edited
+
+        Node* writable(const Node* node) {
+            uint64_t next = base->version + 1;
+            if (node && node->version == next) return const_cast<Node*>(node);
+            Node* copy = node ? new Node(*node) : new Node();
+            if (node) replacedNodes.push_back(node);
+            copy->version = next;
+            return copy;
+        }
+
+        // Stores `value` under `key` and returns what it replaced
+        const void* set(Node*& root, uint32_t key, const void* value) {
+            root = writable(root);
+            Node* node = root;
+            for (int level = CatalogSnapshot::kLevels - 1; level > 0; --level) {
+                const void*& slot = node->slots[CatalogSnapshot::slotIndex(key, level)];
+                Node* child = writable(static_cast<const Node*>(slot));
+                slot = child;
+                node = child;
+            }
+            const void*& slot = node->slots[CatalogSnapshot::slotIndex(key, 0)];
+            const void* previous = slot;
+            slot = value;
+            return previous;
+        }
+
+        void changeReservation(const std::string& userId, int bookId, bool reserved) {
+            uint32_t key = CatalogSnapshot::bucketKey(userId);
+            std::unique_ptr<ReservationBucket>& bucket = buckets[key];
+            if (!bucket) {
+                const void* published = CatalogSnapshot::find(reservations, key);
+                bucket.reset(published ? new ReservationBucket(*static_cast<const ReservationBucket*>(published))
+                                       : new ReservationBucket());
+            }
+            auto entry = std::find_if(bucket->users.begin(), bucket->users.end(),
+                [&userId](const std::pair<std::string, std::vector<int>>& user) { return user.first == userId; });
+            if (entry == bucket->users.end()) {
+                if (!reserved) return;
+                bucket->users.emplace_back(userId, std::vector<int>());
+                entry = bucket->users.end() - 1;
+            }
+            std::vector<int>& ids = entry->second;
+            auto at = std::lower_bound(ids.begin(), ids.end(), bookId);
+            if (reserved && (at == ids.end() || *at != bookId)) {
+                ids.insert(at, bookId);
+            } else if (!reserved && at != ids.end() && *at == bookId) {
+                ids.erase(at);
+                if (ids.empty()) bucket->users.erase(entry);
+            }
+        }
+
+        void diffReservations(int bookId, const std::vector<std::string>& before, const std::vector<std::string>& after) {
+            for (const std::string& userId : before) {
+                if (std::find(after.begin(), after.end(), userId) == after.end()) changeReservation(userId, bookId, false);
+            }
+            for (const std::string& userId : after) {
+                if (std::find(before.begin(), before.end(), userId) == before.end()) changeReservation(userId, bookId, true);
+            }
+        }
+
+        void replaceBook(int bookId, const BookView* view) {
+            const void* previous = set(books, static_cast<uint32_t>(bookId), view);
+            const BookView* old = static_cast<const BookView*>(previous);
+            static const std::vector<std::string> kNone;
+            diffReservations(bookId, old ? old->getReservedUserIds() : kNone, view ? view->getReservedUserIds() : kNone);
+            if (old) {
+                replacedViews.push_back(old);
+                --bookCount;
+            }
+            if (view) ++bookCount;
+            changed = true;
+        }
+
+    public:
+        explicit Update(PublishedCatalog& catalog)
+            : catalog(catalog), lock(catalog.writerMutex), base(catalog.current.load(std::memory_order_relaxed)),
+              books(const_cast<Node*>(base->books)), reservations(const_cast<Node*>(base->reservations)),
+              bookCount(base->bookCount), changed(false) {}
+        Update(const Update&) = delete;
+        Update& operator=(const Update&) = delete;
+
+        // Publishes the book as it is now
+        void setBook(const Book& book) {
+            if (!CatalogSnapshot::fits(book.getBookId())) return;
+            replaceBook(book.getBookId(), new BookView(book));
+        }
+
+        void removeBook(int bookId) {
+            if (!CatalogSnapshot::fits(bookId) || !CatalogSnapshot::find(books, static_cast<uint32_t>(bookId))) return;
+            replaceBook(bookId, nullptr);
+        }
+
+        ~Update() {
+            if (!changed) return;
+            for (auto& entry : buckets) {
+                ReservationBucket* bucket = entry.second->users.empty() ? nullptr : entry.second.release();
+                replacedBuckets.push_back(static_cast<const ReservationBucket*>(set(reservations, entry.first, bucket)));
+            }
+            CatalogSnapshot* next = new CatalogSnapshot{base->version + 1, bookCount, books, reservations};
+            catalog.current.store(next, std::memory_order_seq_cst);
+
+            catalog.epochs.retire(base);
+            for (const Node* node : replacedNodes) catalog.epochs.retire(node);
+            for (const BookView* view : replacedViews) catalog.epochs.retire(view);
+            for (const ReservationBucket* bucket : replacedBuckets) catalog.epochs.retire(bucket);
+            catalog.epochs.reclaim();
+        }
+    };
+
+    PublishedCatalog() : current(new CatalogSnapshot{0, 0, nullptr, nullptr}) {}
+
+    // No reader may remain
+    ~PublishedCatalog() {
+        const CatalogSnapshot* snapshot = current.load(std::memory_order_relaxed);
+        CatalogSnapshot::forEachNode(snapshot->books, CatalogSnapshot::kLevels - 1,
+            [](const CatalogSnapshot::Node* node, int level) {
+                if (level == 0) {
+                    for (const void* slot : node->slots) delete static_cast<const BookView*>(slot);
+                }
+                delete node;
+            });
+        CatalogSnapshot::forEachNode(snapshot->reservations, CatalogSnapshot::kLevels - 1,
+            [](const CatalogSnapshot::Node* node, int level) {
+                if (level == 0) {
+                    for (const void* slot : node->slots) delete static_cast<const CatalogSnapshot::ReservationBucket*>(slot);
+                }
+                delete node;
+            });
+        delete snapshot;
+    }
+
+    PublishedCatalog(const PublishedCatalog&) = delete;
+    PublishedCatalog& operator=(const PublishedCatalog&) = delete;
+
+    uint64_t version() const { return current.load(std::memory_order_relaxed)->version; }
+};
+
+#endif
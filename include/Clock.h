@@ -0,0 +1,48 @@
+#ifndef CLOCK_H
+#define CLOCK_H
+
+#include <atomic>
+#include <ctime>
+
+// Where the library reads the current time, and how long one of its days
+// lasts. Days default to 10 seconds so loans fall due while testing.
+class Clock {
+private:
+    time_t dayLength;
+
+public:
+    explicit Clock(time_t secondsPerDay = 10) : dayLength(secondsPerDay) {}
+    virtual ~Clock() {}
+
+    virtual time_t now() const = 0;
+
+    time_t secondsPerDay() const { return dayLength; }
+    time_t days(long long count) const { return static_cast<time_t>(count) * dayLength; }
+};
+
+// Wall-clock time
+class SystemClock : public Clock {
+public:
+    time_t now() const override { return time(nullptr); }
+};
+
+// Time that only moves when told to, for simulations and tests
+class VirtualClock : public Clock {
+private:
+    std::atomic<time_t> current;
+
+public:
+    explicit VirtualClock(time_t start, time_t secondsPerDay = 10) : Clock(secondsPerDay), current(start) {}
+
+    time_t now() const override { return current.load(std::memory_order_relaxed); }
+    void set(time_t when) { current.store(when, std::memory_order_relaxed); }
+    void advance(time_t seconds) { current.fetch_add(seconds, std::memory_order_relaxed); }
+};
+
+// Shared wall clock used by default
+inline const Clock& systemClock() {
+    static const SystemClock clock;
+    return clock;
+}
+
+#endif
@@ -0,0 +1,198 @@
+#ifndef DURABLE_FILE_H
+#define DURABLE_FILE_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+
+// Size and hash of a file's contents, to tell whether a file is still the
+// one a checkpoint wrote
+struct FileFingerprint {
+    uint64_t size;
+    uint64_t hash;
+
+    bool operator==(const FileFingerprint& other) const { return size == other.size && hash == other.hash; }
+    bool operator!=(const FileFingerprint& other) const { return !(*this == other); }
+};
+
+// Hashes a byte stream 32 bytes at a time in four independent lanes, so the
+// multiplies overlap; the result does not depend on how the stream is split
+// into add() calls
+class Fingerprinter {
+private:
+    static constexpr uint64_t kPrime1 = 0x9E3779B185EBCA87ULL;
+    static constexpr uint64_t kPrime2 = 0xC2B2AE3D27D4EB4FULL;
+    static constexpr size_t kStripe = 32;
+
+    uint64_t size;
+    uint64_t lanes[4];
+    unsigned char tail[kStripe];  // bytes of an unfinished stripe
+    size_t tailSize;
+
+    static uint64_t rotl(uint64_t x, int bits) { return (x << bits) | (x >> (64 - bits)); }
+
+    static uint64_t load(const unsigned char* p) {
+        uint64_t word;
+        std::memcpy(&word, p, sizeof(word));
+        return word;
+    }
+
+    void mix(const unsigned char* stripe) {
+        for (int lane = 0; lane < 4; ++lane) {
+            lanes[lane] = rotl(lanes[lane] + load(stripe + 8 * lane) * kPrime2, 31) * kPrime1;
+        }
+    }
+
+public:
+    Fingerprinter() : size(0), lanes{kPrime1, kPrime2, 0, ~kPrime1}, tailSize(0) {}
+
+    void add(const char* data, size_t length) {
+        const unsigned char* p = reinterpret_cast<const unsigned char*>(data);
+        size += length;
+        if (tailSize > 0) {
+            size_t take = std::min(length, kStripe - tailSize);
+            std::memcpy(tail + tailSize, p, take);
+            tailSize += take;
+            p += take;
+            length -= take;
+            if (tailSize < kStripe) return;
+            mix(tail);
+            tailSize = 0;
+        }
+        for (; length >= kStripe; p += kStripe, length -= kStripe) mix(p);
+        std::memcpy(tail, p, length);
+        tailSize = length;
+    }
+
+    uint64_t bytes() const { return size; }
+
+    FileFingerprint result() const {
+        uint64_t h = size * kPrime1;
+        for (uint64_t lane : lanes) h = rotl(h ^ lane, 27) * kPrime1 + kPrime2;
+        for (size_t i = 0; i < tailSize; ++i) h = rotl(h ^ (tail[i] * kPrime2), 11) * kPrime1;
+        h ^= h >> 33;
+        h *= kPrime2;
+        h ^= h >> 29;
+        return FileFingerprint{size, h};
+    }
+};
+
+// Fingerprints the file at `path`; false if it cannot be read
+inline bool fingerprintFile(const std::string& path, FileFingerprint& fingerprint) {
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return false;
+    Fingerprinter contents;
+    std::vector<char> block(1 << 20);
+    ssize_t n;
+    while ((n = ::read(fd, block.data(), block.size())) != 0) {
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0) break;
+        contents.add(block.data(), static_cast<size_t>(n));
+    }
+    ::close(fd);
+    fingerprint = contents.result();
+    return n == 0;
+}
+
+// Replaces a file so that a crash leaves either the old or the new contents.
+// Writes go to `path`.tmp; commit() fsyncs it and renames it over `path`.
+// The rename itself is only durable once the directory has been synced
+// (syncDirectory), which callers replacing several files do once at the end.
+class DurableFile {
+private:
+    std::string path;
+    std::string tmpPath;
+    int fd;
+    bool failed;
+    std::string buffer;
+    Fingerprinter written;
+
+    static constexpr size_t kBufferSize = 1 << 20;
+
+    void writeAll(const char* data, size_t left) {
+        while (left > 0 && !failed) {
+            ssize_t n = ::write(fd, data, left);
+            if (n < 0 && errno == EINTR) continue;
+            if (n <= 0) {
+                failed = true;
+                break;
+            }
+            data += n;
+            left -= static_cast<size_t>(n);
+        }
+    }
+
+    void writeOut() {
+        writeAll(buffer.data(), buffer.size());
+        buffer.clear();
+    }
+
+public:
+    explicit DurableFile(const std::string& path)
+        : path(path), tmpPath(path + ".tmp"), fd(-1), failed(false) {
+        fd = ::open(tmpPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        failed = fd < 0;
+        buffer.reserve(kBufferSize);
+    }
+
+    // Drops the temporary file unless commit() succeeded
+    ~DurableFile() {
+        if (fd >= 0) {
+            ::close(fd);
+            ::unlink(tmpPath.c_str());
+        }
+    }
+
+    DurableFile(const DurableFile&) = delete;
+    DurableFile& operator=(const DurableFile&) = delete;
+
+    void write(std::string_view data) {
+        if (failed) return;
+        written.add(data.data(), data.size());
+        if (buffer.size() + data.size() > kBufferSize) {
+            writeOut();
+            // Large blocks, like the snapshot's sections, skip the buffer
+            if (data.size() >= kBufferSize) {
+                writeAll(data.data(), data.size());
+                return;
+            }
+        }
+        buffer.append(data.data(), data.size());
+    }
+
+    // Bytes written so far, and their fingerprint
+    uint64_t size() const { return written.bytes(); }
+    FileFingerprint fingerprint() const { return written.result(); }
+
+    // Flushes, fsyncs and renames into place; false if any step failed, in
+    // which case the file at `path` is untouched
+    bool commit() {
+        if (!failed) writeOut();
+        if (failed || ::fsync(fd) != 0) return false;
+        int closed = ::close(fd);
+        fd = -1;
+        if (closed != 0 || std::rename(tmpPath.c_str(), path.c_str()) != 0) {
+            ::unlink(tmpPath.c_str());
+            return false;
+        }
+        return true;
+    }
+};
+
+// Makes the renames into `dir` durable
+inline bool syncDirectory(const std::string& dir) {
+    int fd = ::open(dir.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd < 0) return false;
+    bool ok = ::fsync(fd) == 0;
+    ::close(fd);
+    return ok;
+}
+
+#endif
@@ -0,0 +1,40 @@
+#ifndef ENTITY_POOLS_H
+#define ENTITY_POOLS_H
+
+#include "ObjectPool.h"
+#include "Student.h"
+#include "Faculty.h"
+#include "Librarian.h"
+#include "Book.h"
+#include "Account.h"
+#include <string>
+#include <ostream>
+
+// Owns every User, Book and Account of a Library
+struct EntityPools {
+    ObjectPool<Student> students;
+    ObjectPool<Faculty> faculty;
+    ObjectPool<Librarian> librarians;
+    ObjectPool<Book> books;
+    ObjectPool<Account> accounts;
+
+    User* createUser(Role role, const std::string& name, const std::string& email, const std::string& id) {
+        switch (role) {
+            case Role::Student: return students.create(name, email, id);
+            case Role::Faculty: return faculty.create(name, email, id);
+            case Role::Librarian: return librarians.create(name, email, id);
+        }
+        return nullptr;
+    }
+
+    void destroyUser(User* user) {
+        if (!user) return;
+        switch (user->getRole()) {
+            case Role::Student: students.destroy(static_cast<Student*>(user)); break;
+            case Role::Faculty: faculty.destroy(static_cast<Faculty*>(user)); break;
+            case Role::Librarian: librarians.destroy(static_cast<Librarian*>(user)); break;
+        }
+    }
+};
+
+#endif
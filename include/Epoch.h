@@ -0,0 +1,176 @@
+#ifndef EPOCH_H
+#define EPOCH_H
+
+#include <atomic>
+#include <mutex>
+#include <vector>
+#include <deque>
+#include <algorithm>
+#include <cstdint>
+#include <cstddef>
+
+// Epoch-based reclamation for data that readers use without taking locks.
+// A reader pins the current epoch for as long as it holds pointers into the
+// shared data; a writer that unlinks an object retires it instead of
+// deleting it, tagged with the epoch at that moment. The global epoch only
+// advances once every pinned reader has seen it, so an object retired in
+// epoch e is deleted once the epoch reaches e + 2, when no reader can still
+// hold it.
+//
+// Each thread pins through its own cache line, so readers never write to
+// shared memory. Threads beyond kMaxThreads share one overflow counter that
+// holds back reclamation while any of them is pinned.
+class EpochDomain {
+public:
+    static constexpr size_t kMaxThreads = 256;
+
+private:
+    static constexpr uint64_t kIdle = 0;
+
+    struct alignas(64) Slot {
+        std::atomic<uint64_t> epoch{kIdle};  // pinned epoch, or kIdle
+        size_t depth = 0;                    // nested pins; touched only by the owner
+    };
+
+    struct Retired {
+        uint64_t epoch;
+        void* object;
+        void (*destroy)(void*);
+    };
+
+    // Process-wide slot numbers, handed out on a thread's first pin and
+    // returned when it exits
+    class ThreadIndex {
+    private:
+        static std::mutex& registryMutex() {
+            static std::mutex mutex;
+            return mutex;
+        }
+        static std::vector<size_t>& freeIndexes() {
+            static std::vector<size_t> indexes;
+            return indexes;
+        }
+
+    public:
+        // Slot numbers handed out so far; higher slots have never been used
+        static std::atomic<size_t>& issued() {
+            static std::atomic<size_t> count{0};
+            return count;
+        }
+
+        size_t index;
+
+        ThreadIndex() {
+            std::lock_guard<std::mutex> lock(registryMutex());
+            if (!freeIndexes().empty()) {
+                index = freeIndexes().back();
+                freeIndexes().pop_back();
+            } else {
+                index = issued().fetch_add(1);
+            }
+        }
+        ~ThreadIndex() {
+            std::lock_guard<std::mutex> lock(registryMutex());
+            freeIndexes().push_back(index);
+        }
+    };
+
+    static size_t threadIndex() {
+        static thread_local ThreadIndex self;
+        return self.index;
+    }
+
+    std::atomic<uint64_t> globalEpoch;
+    Slot slots[kMaxThreads];
+    std::atomic<size_t> overflowPins;
+
+    // In retirement order, which is also epoch order: the epoch only
+    // advances under this mutex
+    std::mutex retiredMutex;
+    std::deque<Retired> retired;
+
+    // Advances the epoch if every pinned reader is in the current one
+    void tryAdvance() {
+        if (overflowPins.load(std::memory_order_seq_cst) > 0) return;
+        uint64_t current = globalEpoch.load(std::memory_order_seq_cst);
+        size_t used = std::min(kMaxThreads, ThreadIndex::issued().load(std::memory_order_seq_cst));
+        for (size_t i = 0; i < used; ++i) {
+            uint64_t pinned = slots[i].epoch.load(std::memory_order_seq_cst);
+            if (pinned != kIdle && pinned != current) return;
+        }
+        globalEpoch.compare_exchange_strong(current, current + 1, std::memory_order_seq_cst);
+    }
+
+public:
+    // Keeps the epoch pinned while in scope
+    class Guard {
+    private:
+        EpochDomain& domain;
+        Slot* slot;  // null when pinned through the overflow counter
+
+    public:
+        explicit Guard(EpochDomain& domain) : domain(domain), slot(nullptr) {
+            size_t index = threadIndex();
+            if (index >= kMaxThreads) {
+                domain.overflowPins.fetch_add(1, std::memory_order_seq_cst);
+                return;
+            }
+            slot = &domain.slots[index];
+            if (slot->depth++ == 0) {
+                slot->epoch.store(domain.globalEpoch.load(std::memory_order_seq_cst), std::memory_order_seq_cst);
+            }
+        }
+        ~Guard() {
+            if (!slot) {
+                domain.overflowPins.fetch_sub(1, std::memory_order_seq_cst);
+            } else if (--slot->depth == 0) {
+                slot->epoch.store(kIdle, std::memory_order_release);
+            }
+        }
+        Guard(const Guard&) = delete;
+        Guard& operator=(const Guard&) = delete;
+    };
+
+    EpochDomain() : globalEpoch(1), overflowPins(0) {}
+
+    // Nothing may be pinned any more
+    ~EpochDomain() {
+        for (const Retired& entry : retired) entry.destroy(entry.object);
+    }
+
+    EpochDomain(const EpochDomain&) = delete;
+    EpochDomain& operator=(const EpochDomain&) = delete;
+
+    // Deletes `object` once no reader pinned now or earlier can hold it.
+    // The object must already be unreachable for new readers.
+    template <typename T>
+    void retire(const T* object) {
+        if (!object) return;
+        std::lock_guard<std::mutex> lock(retiredMutex);
+        retired.push_back(Retired{globalEpoch.load(std::memory_order_seq_cst), const_cast<T*>(object),
+                                  [](void* p) { delete static_cast<T*>(p); }});
+    }
+
+    // Advances the epoch if it can and deletes what has become unreachable;
+    // returns how many objects are still waiting
+    size_t reclaim() {
+        std::vector<Retired> ready;
+        size_t waiting;
+        {
+            std::lock_guard<std::mutex> lock(retiredMutex);
+            tryAdvance();
+            uint64_t safe = globalEpoch.load(std::memory_order_seq_cst);
+            while (!retired.empty() && retired.front().epoch + 2 <= safe) {
+                ready.push_back(retired.front());
+                retired.pop_front();
+            }
+            waiting = retired.size();
+        }
+        for (const Retired& entry : ready) entry.destroy(entry.object);
+        return waiting;
+    }
+
+    uint64_t epoch() const { return globalEpoch.load(std::memory_order_relaxed); }
+};
+
+#endif
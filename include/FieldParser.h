@@ -0,0 +1,100 @@
+#ifndef FIELD_PARSER_H
+#define FIELD_PARSER_H
+
+#include <string>
+#include <string_view>
+#include <charconv>
+#include <fstream>
+#include <cstddef>
+
+// Allocation-free helpers for the pipe-delimited data files. All views point
+// into a buffer owned by the caller, which must outlive them.
+
+// Splits one record into fields without copying
+class FieldReader {
+private:
+    std::string_view line;
+    size_t pos;
+    bool done;
+
+public:
+    explicit FieldReader(std::string_view line) : line(line), pos(0), done(false) {}
+
+    // Returns false once every field has been consumed
+    bool next(std::string_view& field, char delim = '|') {
+        if (done) return false;
+        size_t end = line.find(delim, pos);
+        if (end == std::string_view::npos) {
+            field = line.substr(pos);
+            done = true;
+        } else {
+            field = line.substr(pos, end - pos);
+            pos = end + 1;
+        }
+        return true;
+    }
+
+    // Everything not yet consumed, delimiters included
+    std::string_view rest() const { return done ? std::string_view() : line.substr(pos); }
+};
+
+// Iterates over the lines of a buffer, tracking 1-based line numbers
+class LineReader {
+private:
+    std::string_view buffer;
+    size_t pos;
+    size_t lineNumber;
+
+public:
+    explicit LineReader(std::string_view buffer) : buffer(buffer), pos(0), lineNumber(0) {}
+
+    bool next(std::string_view& line) {
+        if (pos >= buffer.size()) return false;
+        size_t end = buffer.find('\n', pos);
+        if (end == std::string_view::npos) end = buffer.size();
+        line = buffer.substr(pos, end - pos);
+        if (!line.empty() && line.back() == '\r') line.remove_suffix(1);
+        pos = end + 1;
+        ++lineNumber;
+        return true;
+    }
+
+    size_t getLineNumber() const { return lineNumber; }
+};
+
+// Splits a record into at most `maxFields` views; returns the real field count
+inline size_t splitFields(std::string_view line, std::string_view* fields, size_t maxFields, char delim = '|') {
+    FieldReader reader(line);
+    std::string_view field;
+    size_t count = 0;
+    while (reader.next(field, delim)) {
+        if (count < maxFields) fields[count] = field;
+        ++count;
+    }
+    return count;
+}
+
+inline bool parseInt(std::string_view text, int& value) {
+    const char* end = text.data() + text.size();
+    auto result = std::from_chars(text.data(), end, value);
+    return result.ec == std::errc() && result.ptr == end && !text.empty();
+}
+
+inline bool parseDouble(std::string_view text, double& value) {
+    const char* end = text.data() + text.size();
+    auto result = std::from_chars(text.data(), end, value);
+    return result.ec == std::errc() && result.ptr == end && !text.empty();
+}
+
+// Reads a whole file into one buffer; empty if the file cannot be opened
+inline std::string readWholeFile(const std::string& path) {
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if (!file) return std::string();
+    std::string contents(static_cast<size_t>(file.tellg()), '\0');
+    file.seekg(0);
+    file.read(&contents[0], static_cast<std::streamsize>(contents.size()));
+    contents.resize(static_cast<size_t>(file.gcount()));
+    return contents;
+}
+
+#endif
@@ -0,0 +1,154 @@
+#ifndef ISBN_INDEX_H
+#define ISBN_INDEX_H
+
+#include "Book.h"
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cstdint>
+
+// ISBN without hyphens or spaces, with a check digit 'x' written as 'X', so
+// "978-0-13-110362-7" and "9780131103627" compare equal
+inline std::string normalizeIsbn(std::string_view isbn) {
+    std::string normalized;
+    for (char c : isbn) {
+        if (c == '-' || c == ' ') continue;
+        normalized += (c == 'x') ? 'X' : c;
+    }
+    return normalized;
+}
+
+// Open-addressing (linear probing) hash index from normalized ISBN to book,
+// in the same layout as PatronIndex. ISBNs of up to 15 digits or 'X' are
+// packed four bits per character into a 64-bit key, so a probe compares
+// integers; anything else is keyed by a hash and confirmed against the
+// book's own ISBN. Books without an ISBN are not indexed.
+class IsbnIndex {
+private:
+    struct Slot {
+        uint64_t key;  // 0 marks an empty slot
+        const Book* book;
+    };
+
+    static const uint64_t kHashedKeyFlag = 1ULL << 63;
+
+    std::vector<Slot> slots;
+    size_t count;
+
+    static uint64_t makeKey(const std::string& isbn) {
+        if (isbn.size() <= 15) {
+            uint64_t key = 0;
+            size_t i = 0;
+            for (; i < isbn.size(); ++i) {
+                char c = isbn[i];
+                if (c >= '0' && c <= '9') {
+                    key = (key << 4) | static_cast<uint64_t>(c - '0' + 1);
+                } else if (c == 'X') {
+                    key = (key << 4) | 11;
+                } else {
+                    break;
+                }
+            }
+            if (i == isbn.size()) return key;
+        }
+        uint64_t hash = 14695981039346656037ULL;  // FNV-1a
+        for (char c : isbn) {
+            hash = (hash ^ static_cast<unsigned char>(c)) * 1099511628211ULL;
+        }
+        return hash | kHashedKeyFlag;
+    }
+
+    static uint64_t mix(uint64_t key) {
+        key ^= key >> 33;
+        key *= 0xff51afd7ed558ccdULL;
+        key ^= key >> 33;
+        return key;
+    }
+
+    static bool sameIsbn(const Slot& slot, uint64_t key, const std::string& isbn) {
+        if (slot.key != key) return false;
+        return !(key & kHashedKeyFlag) || normalizeIsbn(slot.book->getIsbn()) == isbn;
+    }
+
+    size_t mask() const { return slots.size() - 1; }
+
+    size_t findSlot(uint64_t key, const std::string& isbn) const {
+        if (slots.empty()) return SIZE_MAX;
+        for (size_t i = mix(key) & mask();; i = (i + 1) & mask()) {
+            if (slots[i].key == 0) return SIZE_MAX;
+            if (sameIsbn(slots[i], key, isbn)) return i;
+        }
+    }
+
+    void grow() {
+        std::vector<Slot> old;
+        old.swap(slots);
+        slots.assign(old.empty() ? 16 : old.size() * 2, Slot{0, nullptr});
+        for (const Slot& slot : old) {
+            if (slot.key == 0) continue;
+            size_t i = mix(slot.key) & mask();
+            while (slots[i].key != 0) i = (i + 1) & mask();
+            slots[i] = slot;
+        }
+    }
+
+    // Backward-shift deletion keeps probe chains intact without tombstones
+    void eraseSlot(size_t hole) {
+        for (size_t i = (hole + 1) & mask(); slots[i].key != 0; i = (i + 1) & mask()) {
+            size_t home = mix(slots[i].key) & mask();
+            if (((i - home) & mask()) >= ((i - hole) & mask())) {
+                slots[hole] = slots[i];
+                hole = i;
+            }
+        }
+        slots[hole] = Slot{0, nullptr};
+        --count;
+    }
+
+public:
+    IsbnIndex() : count(0) {}
+
+    const Book* find(std::string_view isbn) const {
+        std::string normalized = normalizeIsbn(isbn);
+        if (normalized.empty()) return nullptr;
+        size_t i = findSlot(makeKey(normalized), normalized);
+        return i == SIZE_MAX ? nullptr : slots[i].book;
+    }
+
+    // Fails, leaving the index unchanged, if another book has the same ISBN
+    bool insert(const Book* book) {
+        std::string normalized = normalizeIsbn(book->getIsbn());
+        if (normalized.empty()) return true;
+        uint64_t key = makeKey(normalized);
+        size_t found = findSlot(key, normalized);
+        if (found != SIZE_MAX) return slots[found].book == book;
+
+        if ((count + 1) * 10 > slots.size() * 7) grow();
+        size_t i = mix(key) & mask();
+        while (slots[i].key != 0) i = (i + 1) & mask();
+        slots[i] = Slot{key, book};
+        ++count;
+        return true;
+    }
+
+    // Only drops the entry if it belongs to this book, not to a duplicate
+    void remove(const Book* book) {
+        std::string normalized = normalizeIsbn(book->getIsbn());
+        if (normalized.empty()) return;
+        size_t i = findSlot(makeKey(normalized), normalized);
+        if (i != SIZE_MAX && slots[i].book == book) eraseSlot(i);
+    }
+
+    void reserve(size_t expected) {
+        while (expected * 10 > slots.size() * 7) grow();
+    }
+
+    void clear() {
+        slots.clear();
+        count = 0;
+    }
+
+    size_t size() const { return count; }
+};
+
+#endif
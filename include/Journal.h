@@ -0,0 +1,54 @@
+#ifndef JOURNAL_H
+#define JOURNAL_H
+
+#include <string>
+#include <vector>
+#include <cstddef>
+#include <sys/types.h>
+
+// A single journal entry: a one-character record type followed by the
+// pipe-delimited payload of the entity it describes.
+struct JournalRecord {
+    char type;
+    std::string payload;
+};
+
+// Append-only operation journal kept next to the data files. Every mutation
+// is written as one small line; the data files themselves are only rewritten
+// on checkpoint. Records are flushed to the kernel immediately and fsynced in
+// groups of `groupSize` (or on sync()), so a checkout costs one short write.
+class Journal {
+private:
+    std::string path;
+    int fd;
+    size_t groupSize;
+    size_t pending;  // records written since the last fsync
+    off_t size;      // bytes of complete records
+
+    void dropTornRecord();
+
+public:
+    Journal(const std::string& path, size_t groupSize = 32);
+    ~Journal();
+
+    Journal(const Journal&) = delete;
+    Journal& operator=(const Journal&) = delete;
+
+    // False if the record could not be written or committed; a record
+    // that was only partly written is removed again
+    bool append(char type, const std::string& payload);
+    bool sync();
+
+    // Reads back every complete record; a torn trailing record is ignored
+    std::vector<JournalRecord> readAll() const;
+
+    // Discards all records, called once a checkpoint has been written
+    void reset();
+
+    bool empty() const;
+    // Bytes of complete records in the journal
+    off_t getSize() const { return size; }
+    const std::string& getPath() const { return path; }
+};
+
+#endif
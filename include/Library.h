@@ -4,40 +4,276 @@
 #include "User.h"
 #include "Book.h"
 #include "Account.h"
+#include "BookStore.h"
+#include "CatalogIndex.h"
+#include "IsbnIndex.h"
+#include "EntityPools.h"
+#include "Journal.h"
+#include "Snapshot.h"
+#include "PatronIndex.h"
+#include "SearchIndex.h"
+#include "PrefixIndex.h"
+#include "TimerQueue.h"
+#include "LoanTable.h"
+#include "Clock.h"
+#include "ScanEngine.h"
+#include "CatalogSnapshot.h"
 #include <vector>
-#include <map>
+#include <unordered_map>
+#include <set>
 #include <string>
+#include <ostream>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <thread>
+#include <condition_variable>
 
+// When buffered mutations are written to the journal
+enum class CommitPolicy {
+    Immediate,         // after every operation
+    EveryNOperations,  // after N operations
+    Interval           // every T milliseconds, by a background flusher
+};
+
+// One borrow, return or reservation in a batch
+struct CirculationRequest {
+    enum class Action { Borrow, Return, Reserve };
+    Action action;
+    std::string userId;
+    int bookId;
+};
+
+// What became of one request in a batch. NotApplied requests passed their
+// checks but were dropped with the batch because another was refused.
+struct CirculationResult {
+    enum class Outcome { Applied, Refused, NotApplied };
+    Outcome outcome;
+    std::string reason;  // why it was refused or not applied
+};
+
+// Concurrency: borrowBook, returnBook, reserveBook, cancelReservation and
+// payFine may run in parallel from many threads, as may the lookups
+// (getUser, getBook, getAccount, searches and filters). Everything else
+// (adding and removing users, books and accounts, fine and hold sweeps,
+// checkpoints) runs alone, waiting for circulation in flight to finish.
+// getUser, getBook and getAccount take no lock, so they do not wait for
+// those either.
+// Book and account objects returned by lookups stay valid until they are
+// removed; reading their fields while other threads circulate them is only
+// safe inside the library. To read books from another thread, use
+// readCatalog(): it returns a consistent snapshot of every book and
+// reservation, taken without locks and republished after each operation.
+// The display methods are for the single-threaded menu.
 class Library {
 private:
     std::string dataDir;
+    const Clock& clock;  // all circulation times and day lengths come from here
+
+    // Owns every entity below; declared first so it is destroyed last
+    EntityPools pools;
+
     std::vector<User*> users;
-    std::vector<Book*> books;
+    BookStore books;
+    ScanEngine bookText;  // folded title/author/publisher text for substring filters
     std::vector<Account*> accounts;
     
-    std::map<std::string, User*> userMap;
-    std::map<int, Book*> bookMap;
-    std::map<std::string, Account*> accountMap;
+    // User and account of each user id, resolved by a single probe
+    PatronIndex patrons;
+
+    // Locking. Structural changes hold structureMutex exclusively;
+    // circulation holds it shared plus the stripe of the account it works
+    // on and then the stripe of the book, always in that order. The indexes
+    // circulation shares have leaf locks, held briefly and never while
+    // taking another lock.
+    static constexpr size_t kLockStripes = 64;
+    mutable std::shared_mutex structureMutex;
+    mutable std::mutex accountStripes[kLockStripes];
+    mutable std::mutex bookStripes[kLockStripes];
+    mutable std::mutex catalogMutex;  // catalogIndex
+    std::mutex loanMutex;             // dueLoans, loanTable
+    std::mutex holdMutex;             // holdExpiries
+
+    // Reverse reservation index: user id -> ids of the books they reserved,
+    // in one shard per account stripe, guarded by that stripe
+    std::unordered_map<std::string, std::set<int>> reservationsByUser[kLockStripes];
+    SearchIndex searchIndex;  // title/author/publisher terms
+    PrefixIndex prefixIndex;  // normalized titles and authors
+    CatalogIndex catalogIndex;  // status/publisher/year bitmaps
+    IsbnIndex isbnIndex;        // normalized ISBN -> book
+
+    // Immutable copy of the catalog for lock-free readers; each operation
+    // publishes the books it changed as one new version
+    PublishedCatalog publishedCatalog;
+
+    // Unreturned loans that can incur fines, keyed by when their fine next
+    // grows; loans that were returned or whose account is gone are skipped
+    struct DueLoan {
+        std::string userId;
+        size_t record;  // index in the account's borrow history
+        int bookId;
+    };
+    TimerQueue<DueLoan> dueLoans;
+    LoanTable loanTable;  // the same loans by column, for batch fine runs
+
+    // Holds of patrons notified that a reserved book is back, keyed by when
+    // the hold lapses; a hold that was since borrowed or cancelled no longer
+    // matches the book's queue and is skipped
+    struct HoldExpiry {
+        int bookId;
+        std::string userId;
+        time_t expiry;
+    };
+    TimerQueue<HoldExpiry> holdExpiries;
+
+    // Append-only log of mutations since the last checkpoint
+    std::unique_ptr<Journal> journal;
+    uint64_t checkpointGeneration;  // of the last checkpoint written or loaded
+
+    // Journal records of the entities changed since the last flush, each
+    // formatted when the operation that changed it ended; one per entity
+    enum class DirtyState { Updated, Removed };
+    struct DirtyRecord {
+        char type;
+        std::string payload;
+    };
+    std::unordered_map<std::string, DirtyRecord> dirtyUsers;
+    std::unordered_map<int, DirtyRecord> dirtyBooks;
+    std::unordered_map<std::string, DirtyRecord> dirtyAccounts;
+    std::mutex dirtyMutex;     // the dirty records and pendingOperations
+    std::mutex journalMutex;   // the journal, in flush order, and the flusher
+
+    // Commit policy; changed only with structureMutex held exclusively
+    CommitPolicy commitPolicy;
+    size_t commitParameter;     // N operations or T milliseconds
+    size_t pendingOperations;   // operations buffered since the last flush
+    std::thread flusher;
+    std::condition_variable flusherCv;
+    bool stopFlusher;
+
+    // Locks for one public operation: the structure lock exclusively, or
+    // shared with the stripes of one account and book. Entities marked dirty
+    // are journaled when the outermost scope ends, while its locks are still
+    // held; a nested call on the same thread reuses the outer scope.
+    class MutationScope {
+    private:
+        Library& library;
+        MutationScope* outer;     // scope active on this thread before this one
+        const Library* previous;  // lockingLibrary before this scope
+        bool owner;               // false when nested in a scope of this library
+        bool exclusive;
+        std::mutex* accountStripe;
+        std::mutex* bookStripe;
+        std::vector<std::pair<std::string, DirtyState>> users;
+        std::vector<std::pair<int, DirtyState>> books;
+        std::vector<std::pair<std::string, DirtyState>> accounts;
+        friend class Library;
+
+    public:
+        explicit MutationScope(Library& lib);
+        MutationScope(Library& lib, const std::string& userId, int bookId);
+        ~MutationScope();
+        MutationScope(const MutationScope&) = delete;
+        MutationScope& operator=(const MutationScope&) = delete;
+    };
+
+    // Shared hold of the structure lock for lookups, unless this thread is
+    // already inside an operation on this library
+    class ReadScope {
+    private:
+        const Library& library;
+        const Library* previous;
+        bool owner;
+    public:
+        explicit ReadScope(const Library& lib);
+        ~ReadScope();
+        ReadScope(const ReadScope&) = delete;
+        ReadScope& operator=(const ReadScope&) = delete;
+    };
+
+    static thread_local MutationScope* activeScope;
+    static thread_local const Library* lockingLibrary;  // whose structure lock this thread holds
 
     // Data loading and saving
     void loadData();
-    void loadUsers();
-    void loadBooks();
-    void loadAccounts();
-    void saveData();
-    void saveUsers();
-    void saveBooks();
-    void saveAccounts();
+    void loadTextFiles();
+    bool saveData(snapshot::Checkpoint& saved);
+    bool saveUsers(FileFingerprint& saved);
+    bool saveBooks(FileFingerprint& saved);
+    bool saveAccounts(FileFingerprint& saved);
     void initializeDefaultData();
 
+    // Binary snapshot (data/library.snap)
+    bool snapshotMatchesTextFiles(const snapshot::Reader& reader) const;
+    bool loadSnapshot();
+    void saveSnapshot(const snapshot::Checkpoint& saved) const;
+
+    // Journaling. A replay looks users and accounts up by id rather than
+    // scanning the vectors for every record.
+    struct ReplayPositions {
+        std::unordered_map<std::string, size_t> users;
+        std::unordered_map<std::string, size_t> accounts;
+    };
+    void replayJournal();
+    bool applyJournalRecord(const JournalRecord& record, ReplayPositions& positions);
+    void checkpoint();
+    void clearDirty();
+
+    // Dirty tracking
+    void markUserDirty(const std::string& userId, DirtyState state = DirtyState::Updated);
+    void markBookDirty(int bookId, DirtyState state = DirtyState::Updated);
+    void markAccountDirty(const std::string& userId, DirtyState state = DirtyState::Updated);
+    void recordDirty(MutationScope& scope);
+    void commitOperation();
+    bool flushLocked();
+    void startFlusher();
+    void stopFlusherThread();
+
+    void publishBooks(const MutationScope& scope);
+
+    // Catalog indexes; unindexBook must see the text the book was indexed under.
+    // indexBook returns false if another book already has the same ISBN.
+    bool indexBook(const Book* book);
+    void unindexBook(const Book* book);
+    void rebuildBookIndexes();
+
+    // Fine accrual
+    void scheduleFine(const std::string& userId, const RolePolicy& policy, size_t record);
+    void rebuildLoanIndexes();
+    void accrueFine(Account* account, const RolePolicy& policy, size_t record, time_t now);
+
+    // Circulation once its checks have passed
+    void applyBorrow(const Patron& patron, Book* book);
+    void applyReturn(const Patron& patron, Book* book);
+    bool applyReserve(const std::string& userId, Book* book);
+
+    // Reservation holds
+    void scheduleHold(const Book* book);
+    bool offerToNextReservation(Book* book);
+
     // Helper methods
     int generateBookId() const;
+    std::mutex& accountStripe(const std::string& userId) const;
+    std::mutex& bookStripe(int bookId) const;
+    std::unordered_map<std::string, std::set<int>>& reservationShard(const std::string& userId);
+    void unindexReservation(const std::string& userId, int bookId);
     bool fileExistsAndHasContent(const std::string& filename) const;
 
 public:
-    Library(const std::string& dir = "data");
+    Library(const std::string& dir = "data", const Clock& clock = systemClock());
     ~Library();
 
+    // Persistence
+    void setCommitPolicy(CommitPolicy policy, size_t parameter = 0);
+    // Commits every buffered change to the journal; false if the journal
+    // could not be written or synced, in which case the changes stay
+    // buffered for the next flush
+    bool flush();
+    // Checkpoints once the journal holds more than `maxJournalBytes`, so a
+    // long-running process keeps the journal, and the replay after a crash,
+    // short
+    void checkpointIfJournalExceeds(uint64_t maxJournalBytes);
+
     // User management
     User* addUser(const std::string& name, const std::string& email, 
                  const std::string& password, const std::string& type, const std::string& id);
@@ -50,7 +286,16 @@ public:
                  const std::string& publisher, int year, const std::string& isbn);
     bool removeBook(int bookId);
     Book* getBook(int bookId) const;
-    const std::vector<Book*>& getAllBooks() const;
+    Book* findBookByIsbn(const std::string& isbn) const;
+    std::vector<Book*> getAllBooks() const;
+    std::vector<Book*> searchBooks(const std::string& query, size_t limit = 20) const;
+    std::vector<Book*> autocompleteBooks(const std::string& prefix, size_t limit = 10) const;
+    std::vector<Book*> fuzzySearchBooks(const std::string& query, std::string& suggestion, size_t limit = 20) const;
+    std::vector<Book*> findBooksContaining(const std::string& text, size_t limit = 20) const;
+    std::vector<Book*> findBooks(const std::string& query, std::string& suggestion) const;
+    std::vector<Book*> filterBooks(const BookFilter& filter, size_t limit = SIZE_MAX) const;
+    size_t countBooks(const BookFilter& filter) const;
+    PublishedCatalog::Reader readCatalog() const;
     bool updateBook(int bookId, const std::string& title, const std::string& author,
                    const std::string& publisher, int year, const std::string& isbn);
 
@@ -59,19 +304,28 @@ public:
     bool removeAccount(const std::string& accountId);
     Account* getAccount(const std::string& userId) const;
     Account* getAccountByUserId(const std::string& userId) const;
+    Patron getPatron(const std::string& userId) const;
 
     // Library operations
     bool borrowBook(const std::string& userId, int bookId);
     bool returnBook(const std::string& userId, int bookId);
+    // Checks every request against the state the ones before it leave, then
+    // applies them all as one operation with one commit, or none of them if
+    // any is refused. Returns whether the batch was applied.
+    bool applyBatch(const std::vector<CirculationRequest>& requests, std::vector<CirculationResult>& results);
     double calculateFine(const std::string& userId, int bookId) const;
     void payFine(const std::string& userId, double amount);
     void updateFines();
     void calculateFines();
+    void calculateFinesBatch();
 
     // Display methods
     void displayAllBooks() const;
+    void displayAvailableBooks() const;
+    void displayCatalogReport(const BookFilter& filter) const;
     void displayUserDetails(const std::string& userId) const;
     void displayUserBorrowHistory(const std::string& userId) const;
+    void printMemoryReport(std::ostream& out) const;
 
     // Authentication
     User* authenticateUser(const std::string& userId, const std::string& password);
@@ -0,0 +1,223 @@
+#ifndef LOAN_TABLE_H
+#define LOAN_TABLE_H
+
+#include "Account.h"
+#include "Policy.h"
+#include <vector>
+#include <unordered_map>
+#include <functional>
+#include <algorithm>
+#include <ctime>
+#include <cstdint>
+#include <cstddef>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define LOAN_TABLE_X86 1
+#endif
+
+// Unreturned loans stored column by column, one segment per role, for fine
+// runs over every active loan at once. Within a segment the grace period
+// and daily rate are constants, so computing the fines is one branch-free
+// pass over the contiguous due dates: four loans at a time with AVX2 or two
+// with SSE2, picked at run time, with a plain loop as the fallback. All
+// variants apply the same rule as the per-loan path, in doubles that hold
+// whole seconds and days exactly.
+//
+// Rows are swap-removed, so their order is not stable; a hash map keeps
+// each loan's row for removal.
+class LoanTable {
+public:
+    struct Segment {
+        std::vector<double> dueDates;   // time_t values, exact below 2^53
+        std::vector<Account*> accounts;
+        std::vector<uint32_t> records;  // index in the account's borrow history
+        std::vector<int> bookIds;
+        std::vector<double> fines;      // filled by computeFines
+
+        size_t size() const { return dueDates.size(); }
+    };
+
+private:
+    // Days overdue are truncated through int32; loans overdue longer than
+    // this are charged as if overdue exactly this long
+    static constexpr double kMaxDays = 2e9;
+
+    struct Key {
+        const Account* account;
+        int bookId;
+        bool operator==(const Key& other) const {
+            return account == other.account && bookId == other.bookId;
+        }
+    };
+
+    struct KeyHash {
+        size_t operator()(const Key& key) const {
+            return std::hash<const void*>()(key.account) * 31 + static_cast<size_t>(key.bookId);
+        }
+    };
+
+    struct Position {
+        uint8_t role;
+        uint32_t row;
+    };
+
+    Segment segments[3];  // indexed by Role
+    std::unordered_map<Key, Position, KeyHash> positions;
+
+    enum class Isa { Scalar, Sse2, Avx2 };
+    Isa isa;
+
+    static Isa detectIsa() {
+#ifdef LOAN_TABLE_X86
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2")) return Isa::Avx2;
+        if (__builtin_cpu_supports("sse2")) return Isa::Sse2;
+#endif
+        return Isa::Scalar;
+    }
+
+    // fines[i] = max(trunc(max(now - due[i], 0) / day) - grace, 0) * rate
+    // for i in [from, n). Each variant handles whole blocks and leaves the
+    // tail to finesScalar.
+    static void finesScalar(const double* due, double* fines, size_t from, size_t n,
+                            double now, double day, double grace, double rate) {
+        for (size_t i = from; i < n; ++i) {
+            double overdue = std::max(now - due[i], 0.0);
+            double days = static_cast<double>(static_cast<int32_t>(std::min(overdue / day, kMaxDays)));
+            fines[i] = std::max(days - grace, 0.0) * rate;
+        }
+    }
+
+#ifdef LOAN_TABLE_X86
+#ifdef __SSE2__
+    static void finesSse2(const double* due, double* fines, size_t n,
+                          double now, double day, double grace, double rate) {
+        const __m128d vNow = _mm_set1_pd(now), vDay = _mm_set1_pd(day);
+        const __m128d vGrace = _mm_set1_pd(grace), vRate = _mm_set1_pd(rate);
+        const __m128d zero = _mm_setzero_pd(), maxDays = _mm_set1_pd(kMaxDays);
+        size_t i = 0;
+        for (; i + 2 <= n; i += 2) {
+            __m128d overdue = _mm_max_pd(_mm_sub_pd(vNow, _mm_loadu_pd(due + i)), zero);
+            __m128d days = _mm_cvtepi32_pd(_mm_cvttpd_epi32(_mm_min_pd(_mm_div_pd(overdue, vDay), maxDays)));
+            _mm_storeu_pd(fines + i, _mm_mul_pd(_mm_max_pd(_mm_sub_pd(days, vGrace), zero), vRate));
+        }
+        finesScalar(due, fines, i, n, now, day, grace, rate);
+    }
+#endif
+
+    __attribute__((target("avx2")))
+    static void finesAvx2(const double* due, double* fines, size_t n,
+                          double now, double day, double grace, double rate) {
+        const __m256d vNow = _mm256_set1_pd(now), vDay = _mm256_set1_pd(day);
+        const __m256d vGrace = _mm256_set1_pd(grace), vRate = _mm256_set1_pd(rate);
+        const __m256d zero = _mm256_setzero_pd(), maxDays = _mm256_set1_pd(kMaxDays);
+        size_t i = 0;
+        for (; i + 4 <= n; i += 4) {
+            __m256d overdue = _mm256_max_pd(_mm256_sub_pd(vNow, _mm256_loadu_pd(due + i)), zero);
+            __m256d days = _mm256_cvtepi32_pd(
+                _mm256_cvttpd_epi32(_mm256_min_pd(_mm256_div_pd(overdue, vDay), maxDays)));
+            _mm256_storeu_pd(fines + i, _mm256_mul_pd(_mm256_max_pd(_mm256_sub_pd(days, vGrace), zero), vRate));
+        }
+        finesScalar(due, fines, i, n, now, day, grace, rate);
+    }
+#endif
+
+    void eraseRow(uint8_t role, uint32_t row) {
+        Segment& segment = segments[role];
+        uint32_t last = static_cast<uint32_t>(segment.size() - 1);
+        if (row != last) {
+            segment.dueDates[row] = segment.dueDates[last];
+            segment.accounts[row] = segment.accounts[last];
+            segment.records[row] = segment.records[last];
+            segment.bookIds[row] = segment.bookIds[last];
+            positions[Key{segment.accounts[row], segment.bookIds[row]}].row = row;
+        }
+        segment.dueDates.pop_back();
+        segment.accounts.pop_back();
+        segment.records.pop_back();
+        segment.bookIds.pop_back();
+        segment.fines.resize(segment.size());
+    }
+
+public:
+    LoanTable() : isa(detectIsa()) {}
+
+    // Adds the loan at `record` in the account's history; roles that never
+    // pay fines are tracked too, so counts cover every active loan
+    void add(Account* account, Role role, size_t record) {
+        const BorrowRecord& loan = account->getBorrowHistory()[record];
+        remove(account, loan.bookId);
+        uint8_t index = static_cast<uint8_t>(role);
+        Segment& segment = segments[index];
+        positions[Key{account, loan.bookId}] = Position{index, static_cast<uint32_t>(segment.size())};
+        segment.dueDates.push_back(static_cast<double>(loan.dueDate));
+        segment.accounts.push_back(account);
+        segment.records.push_back(static_cast<uint32_t>(record));
+        segment.bookIds.push_back(loan.bookId);
+        segment.fines.push_back(0.0);
+    }
+
+    void remove(const Account* account, int bookId) {
+        auto it = positions.find(Key{account, bookId});
+        if (it == positions.end()) return;
+        Position position = it->second;
+        positions.erase(it);
+        eraseRow(position.role, position.row);
+    }
+
+    // Drops every loan of an account that is about to be destroyed
+    void removeAccount(const Account* account) {
+        for (int bookId : account->getCurrentlyBorrowedBooks()) remove(account, bookId);
+    }
+
+    void clear() {
+        for (Segment& segment : segments) segment = Segment();
+        positions.clear();
+    }
+
+    size_t size() const { return positions.size(); }
+    const Segment& segment(Role role) const { return segments[static_cast<int>(role)]; }
+
+    // Fills every segment's `fines` with the fine owed as of `now`
+    void computeFines(time_t now, time_t secondsPerDay) {
+        for (Role role : {Role::Student, Role::Faculty, Role::Librarian}) {
+            Segment& segment = segments[static_cast<int>(role)];
+            const RolePolicy& policy = policyFor(role);
+            double* fines = segment.fines.data();
+            if (policy.finePerDay <= 0) {
+                std::fill(segment.fines.begin(), segment.fines.end(), 0.0);
+                continue;
+            }
+            const double* due = segment.dueDates.data();
+            double at = static_cast<double>(now);
+            double day = static_cast<double>(secondsPerDay);
+            double grace = static_cast<double>(policy.fineGraceDays);
+#ifdef LOAN_TABLE_X86
+            if (isa == Isa::Avx2) {
+                finesAvx2(due, fines, segment.size(), at, day, grace, policy.finePerDay);
+                continue;
+            }
+#ifdef __SSE2__
+            if (isa == Isa::Sse2) {
+                finesSse2(due, fines, segment.size(), at, day, grace, policy.finePerDay);
+                continue;
+            }
+#endif
+#endif
+            finesScalar(due, fines, 0, segment.size(), at, day, grace, policy.finePerDay);
+        }
+    }
+
+    // Calls f(account, record, fine) for every loan computeFines found owing
+    template <typename F>
+    void forEachFine(F f) const {
+        for (const Segment& segment : segments) {
+            for (size_t row = 0; row < segment.size(); ++row) {
+                if (segment.fines[row] > 0) f(segment.accounts[row], segment.records[row], segment.fines[row]);
+            }
+        }
+    }
+};
+
+#endif
@@ -0,0 +1,153 @@
+#ifndef OBJECT_POOL_H
+#define OBJECT_POOL_H
+
+#include <vector>
+#include <algorithm>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <functional>
+#include <utility>
+#include <cstddef>
+
+// Typed object pool. Objects are constructed in place inside chunks that
+// start small and double up to MaxChunkSize slots, destroyed slots go on a
+// free list for reuse, and every remaining object is released together when
+// the pool is destroyed. Addresses are stable for the lifetime of an object.
+// create() and destroy() are safe to call from several threads.
+template <typename T, size_t MaxChunkSize = 4096>
+class ObjectPool {
+private:
+    static constexpr size_t kFirstChunkSize = 16;
+
+    struct Slot {
+        alignas(T) unsigned char storage[sizeof(T)];
+    };
+
+    struct Chunk {
+        std::unique_ptr<Slot[]> slots;
+        std::unique_ptr<bool[]> live;
+        size_t capacity;
+
+        explicit Chunk(size_t capacity)
+            : slots(new Slot[capacity]), live(new bool[capacity]()), capacity(capacity) {}
+    };
+
+    std::vector<std::unique_ptr<Chunk>> chunks;
+    std::vector<Chunk*> chunksByAddress;  // sorted by slot address, for finding an object's chunk
+    std::vector<std::pair<Chunk*, size_t>> freeSlots;
+    size_t used;       // slots handed out from the newest chunk
+    size_t liveCount;
+    size_t slotCount;
+    mutable std::mutex mutex;
+
+    static bool slotsBefore(const Chunk* a, const Chunk* b) {
+        return std::less<const Slot*>()(a->slots.get(), b->slots.get());
+    }
+
+    std::pair<Chunk*, size_t> acquireSlot() {
+        if (!freeSlots.empty()) {
+            std::pair<Chunk*, size_t> slot = freeSlots.back();
+            freeSlots.pop_back();
+            return slot;
+        }
+        if (chunks.empty() || used == chunks.back()->capacity) {
+            size_t capacity = chunks.empty() ? kFirstChunkSize
+                                             : std::min(chunks.back()->capacity * 2, MaxChunkSize);
+            chunks.emplace_back(new Chunk(capacity));
+            Chunk* chunk = chunks.back().get();
+            chunksByAddress.insert(std::upper_bound(chunksByAddress.begin(), chunksByAddress.end(), chunk,
+                                                    slotsBefore), chunk);
+            slotCount += capacity;
+            used = 0;
+        }
+        return std::make_pair(chunks.back().get(), used++);
+    }
+
+    // Finds the chunk and index that own `object`
+    bool locate(const T* object, Chunk*& chunk, size_t& index) const {
+        const Slot* key = reinterpret_cast<const Slot*>(object);
+        auto it = std::upper_bound(chunksByAddress.begin(), chunksByAddress.end(), key,
+                                   [](const Slot* slot, const Chunk* c) {
+                                       return std::less<const Slot*>()(slot, c->slots.get());
+                                   });
+        if (it == chunksByAddress.begin()) return false;
+        Chunk* candidate = *(it - 1);
+
+        size_t offset = static_cast<size_t>(reinterpret_cast<const unsigned char*>(object) -
+                                            candidate->slots[0].storage);
+        if (offset >= sizeof(Slot) * candidate->capacity || offset % sizeof(Slot) != 0) return false;
+        chunk = candidate;
+        index = offset / sizeof(Slot);
+        return true;
+    }
+
+public:
+    ObjectPool() : used(0), liveCount(0), slotCount(0) {}
+
+    ~ObjectPool() {
+        clear();
+    }
+
+    ObjectPool(const ObjectPool&) = delete;
+    ObjectPool& operator=(const ObjectPool&) = delete;
+
+    template <typename... Args>
+    T* create(Args&&... args) {
+        std::pair<Chunk*, size_t> slot;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            slot = acquireSlot();
+            slot.first->live[slot.second] = true;
+            ++liveCount;
+        }
+        return new (slot.first->slots[slot.second].storage) T(std::forward<Args>(args)...);
+    }
+
+    void destroy(T* object) {
+        if (!object) return;
+        std::lock_guard<std::mutex> lock(mutex);
+        Chunk* chunk;
+        size_t index;
+        if (!locate(object, chunk, index) || !chunk->live[index]) return;
+        object->~T();
+        chunk->live[index] = false;
+        freeSlots.emplace_back(chunk, index);
+        --liveCount;
+    }
+
+    // Destroys every live object and releases all chunks at once
+    void clear() {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (const auto& chunk : chunks) {
+            for (size_t i = 0; i < chunk->capacity; ++i) {
+                if (chunk->live[i]) {
+                    reinterpret_cast<T*>(chunk->slots[i].storage)->~T();
+                }
+            }
+        }
+        chunks.clear();
+        chunksByAddress.clear();
+        freeSlots.clear();
+        used = 0;
+        liveCount = 0;
+        slotCount = 0;
+    }
+
+    size_t size() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        return liveCount;
+    }
+
+    size_t capacity() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        return slotCount;
+    }
+
+    size_t bytesReserved() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        return slotCount * (sizeof(Slot) + sizeof(bool)) + chunks.size() * sizeof(Chunk);
+    }
+};
+
+#endif
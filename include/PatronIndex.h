@@ -0,0 +1,245 @@
+#ifndef PATRON_INDEX_H
+#define PATRON_INDEX_H
+
+#include "User.h"
+#include "Account.h"
+#include "Epoch.h"
+#include <string>
+#include <string_view>
+#include <vector>
+#include <atomic>
+#include <thread>
+#include <cstdint>
+#include <cstring>
+
+// A user and their account, found together by one lookup
+struct Patron {
+    User* user;
+    Account* account;
+};
+
+// Open-addressing (linear probing) hash index from user id to Patron.
+// Ids of up to 7 bytes, e.g. "S001", are packed with their length into a
+// single 64-bit key, so a probe compares integers instead of strings. Longer
+// ids are keyed by a hash and confirmed against a copy of the id kept in the
+// slot.
+//
+// Lookups take no lock. Writers, which the caller serializes, bump a version
+// counter around every change that moves or removes entries, and a lookup
+// that overlapped one is retried. A table replaced on growth, and the copy of
+// a removed long id, are retired through an EpochDomain, so a lookup never
+// touches freed memory and never dereferences the users and accounts it
+// returns.
+class PatronIndex {
+private:
+    struct Slot {
+        std::atomic<uint64_t> key{0};  // 0 marks an empty slot
+        std::atomic<const std::string*> longId{nullptr};
+        std::atomic<User*> user{nullptr};
+        std::atomic<Account*> account{nullptr};
+    };
+
+    struct Table {
+        std::vector<Slot> slots;
+        size_t mask;
+
+        explicit Table(size_t size) : slots(size), mask(size - 1) {}
+    };
+
+    static const uint64_t kLongKeyFlag = 1ULL << 63;
+
+    std::atomic<Table*> table;
+    std::atomic<uint64_t> version;  // odd while a writer is moving entries
+    size_t count;
+    mutable EpochDomain epochs;
+
+    static uint64_t makeKey(std::string_view id) {
+        if (id.size() <= 7) {
+            uint64_t key = 0;
+            std::memcpy(&key, id.data(), id.size());
+            return key | (static_cast<uint64_t>(id.size() + 1) << 56);
+        }
+        uint64_t hash = 14695981039346656037ULL;  // FNV-1a
+        for (char c : id) {
+            hash = (hash ^ static_cast<unsigned char>(c)) * 1099511628211ULL;
+        }
+        return hash | kLongKeyFlag;
+    }
+
+    static uint64_t mix(uint64_t key) {
+        key ^= key >> 33;
+        key *= 0xff51afd7ed558ccdULL;
+        key ^= key >> 33;
+        return key;
+    }
+
+    static bool sameId(const Slot& slot, uint64_t key, std::string_view id) {
+        if (slot.key.load(std::memory_order_relaxed) != key) return false;
+        if (!(key & kLongKeyFlag)) return true;
+        const std::string* stored = slot.longId.load(std::memory_order_relaxed);
+        return stored && *stored == id;
+    }
+
+    static size_t findSlot(const Table* current, uint64_t key, std::string_view id) {
+        if (!current) return SIZE_MAX;
+        for (size_t i = mix(key) & current->mask;; i = (i + 1) & current->mask) {
+            if (current->slots[i].key.load(std::memory_order_relaxed) == 0) return SIZE_MAX;
+            if (sameId(current->slots[i], key, id)) return i;
+        }
+    }
+
+    // Writers only
+    Table* writable() const { return table.load(std::memory_order_relaxed); }
+
+    void beginMove() {
+        version.store(version.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+    }
+
+    void endMove() {
+        version.store(version.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    static void copySlot(Slot& to, const Slot& from) {
+        to.longId.store(from.longId.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        to.user.store(from.user.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        to.account.store(from.account.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        to.key.store(from.key.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    }
+
+    // Builds the larger table aside and publishes it in one store; lookups
+    // still on the old one finish there
+    void grow() {
+        Table* old = writable();
+        Table* grown = new Table(old ? old->slots.size() * 2 : 16);
+        if (old) {
+            for (const Slot& slot : old->slots) {
+                uint64_t key = slot.key.load(std::memory_order_relaxed);
+                if (key == 0) continue;
+                size_t i = mix(key) & grown->mask;
+                while (grown->slots[i].key.load(std::memory_order_relaxed) != 0) i = (i + 1) & grown->mask;
+                copySlot(grown->slots[i], slot);
+            }
+        }
+        table.store(grown, std::memory_order_release);
+        epochs.retire(old);
+        epochs.reclaim();
+    }
+
+    Slot& insertOrFind(std::string_view id) {
+        uint64_t key = makeKey(id);
+        size_t found = findSlot(writable(), key, id);
+        if (found != SIZE_MAX) return writable()->slots[found];
+
+        if (!writable() || (count + 1) * 10 > writable()->slots.size() * 7) grow();
+        Table* current = writable();
+        size_t i = mix(key) & current->mask;
+        while (current->slots[i].key.load(std::memory_order_relaxed) != 0) i = (i + 1) & current->mask;
+        Slot& slot = current->slots[i];
+        // Filled before the key makes it visible
+        beginMove();
+        slot.longId.store((key & kLongKeyFlag) ? new std::string(id) : nullptr, std::memory_order_relaxed);
+        slot.user.store(nullptr, std::memory_order_relaxed);
+        slot.account.store(nullptr, std::memory_order_relaxed);
+        slot.key.store(key, std::memory_order_relaxed);
+        endMove();
+        ++count;
+        return slot;
+    }
+
+    // Backward-shift deletion keeps probe chains intact without tombstones
+    void eraseSlot(size_t hole) {
+        Table* current = writable();
+        epochs.retire(current->slots[hole].longId.load(std::memory_order_relaxed));
+        beginMove();
+        for (size_t i = (hole + 1) & current->mask; current->slots[i].key.load(std::memory_order_relaxed) != 0;
+             i = (i + 1) & current->mask) {
+            size_t home = mix(current->slots[i].key.load(std::memory_order_relaxed)) & current->mask;
+            if (((i - home) & current->mask) >= ((i - hole) & current->mask)) {
+                copySlot(current->slots[hole], current->slots[i]);
+                hole = i;
+            }
+        }
+        Slot& emptied = current->slots[hole];
+        emptied.key.store(0, std::memory_order_relaxed);
+        emptied.longId.store(nullptr, std::memory_order_relaxed);
+        emptied.user.store(nullptr, std::memory_order_relaxed);
+        emptied.account.store(nullptr, std::memory_order_relaxed);
+        endMove();
+        --count;
+        epochs.reclaim();
+    }
+
+public:
+    PatronIndex() : table(nullptr), version(0), count(0) {}
+
+    ~PatronIndex() {
+        Table* current = writable();
+        if (!current) return;
+        for (const Slot& slot : current->slots) delete slot.longId.load(std::memory_order_relaxed);
+        delete current;
+    }
+
+    PatronIndex(const PatronIndex&) = delete;
+    PatronIndex& operator=(const PatronIndex&) = delete;
+
+    // Safe while another thread writes; both halves are null if the id is
+    // not indexed
+    Patron find(std::string_view id) const {
+        uint64_t key = makeKey(id);
+        EpochDomain::Guard guard(epochs);
+        while (true) {
+            uint64_t before = version.load(std::memory_order_acquire);
+            if (before & 1) {
+                std::this_thread::yield();
+                continue;
+            }
+            const Table* current = table.load(std::memory_order_acquire);
+            size_t i = findSlot(current, key, id);
+            Patron found{nullptr, nullptr};
+            if (i != SIZE_MAX) {
+                found.user = current->slots[i].user.load(std::memory_order_relaxed);
+                found.account = current->slots[i].account.load(std::memory_order_relaxed);
+            }
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (version.load(std::memory_order_relaxed) == before) return found;
+        }
+    }
+
+    User* findUser(std::string_view id) const { return find(id).user; }
+
+    Account* findAccount(std::string_view id) const { return find(id).account; }
+
+    // Passing nullptr detaches the user; the entry goes once both halves are gone
+    void setUser(std::string_view id, User* user) {
+        if (user) {
+            insertOrFind(id).user.store(user, std::memory_order_release);
+            return;
+        }
+        size_t i = findSlot(writable(), makeKey(id), id);
+        if (i == SIZE_MAX) return;
+        Slot& slot = writable()->slots[i];
+        slot.user.store(nullptr, std::memory_order_release);
+        if (!slot.account.load(std::memory_order_relaxed)) eraseSlot(i);
+    }
+
+    void setAccount(std::string_view id, Account* account) {
+        if (account) {
+            insertOrFind(id).account.store(account, std::memory_order_release);
+            return;
+        }
+        size_t i = findSlot(writable(), makeKey(id), id);
+        if (i == SIZE_MAX) return;
+        Slot& slot = writable()->slots[i];
+        slot.account.store(nullptr, std::memory_order_release);
+        if (!slot.user.load(std::memory_order_relaxed)) eraseSlot(i);
+    }
+
+    void reserve(size_t expected) {
+        while (!writable() || expected * 10 > writable()->slots.size() * 7) grow();
+    }
+
+    size_t size() const { return count; }
+};
+
+#endif
@@ -0,0 +1,59 @@
+#ifndef POLICY_H
+#define POLICY_H
+
+#include <string_view>
+#include <cstdint>
+
+enum class BookStatus : uint8_t { Available, Borrowed, Reserved };
+
+enum class Role : uint8_t { Student, Faculty, Librarian };
+
+// Circulation rules for one role
+struct RolePolicy {
+    std::string_view name;
+    bool canBorrow;
+    int maxBorrowLimit;
+    int loanDays;
+    bool mustReturnBeforeBorrow;  // no new loans while any book is out
+    int fineGraceDays;            // days past the due date before fines start
+    double finePerDay;            // 0 for roles that never pay fines
+};
+
+// Indexed by Role
+constexpr RolePolicy kRolePolicies[] = {
+    {"Student", true, 3, 15, false, 15, 10.0},
+    {"Faculty", true, 5, 30, true, 0, 0.0},
+    {"Librarian", false, 0, 0, false, 0, 0.0},
+};
+
+constexpr const RolePolicy& policyFor(Role role) {
+    return kRolePolicies[static_cast<int>(role)];
+}
+
+inline bool parseRole(std::string_view name, Role& role) {
+    for (Role candidate : {Role::Student, Role::Faculty, Role::Librarian}) {
+        if (policyFor(candidate).name == name) {
+            role = candidate;
+            return true;
+        }
+    }
+    return false;
+}
+
+constexpr std::string_view kBookStatusNames[] = {"Available", "Borrowed", "Reserved"};
+
+constexpr std::string_view toString(BookStatus status) {
+    return kBookStatusNames[static_cast<int>(status)];
+}
+
+inline bool parseBookStatus(std::string_view name, BookStatus& status) {
+    for (BookStatus candidate : {BookStatus::Available, BookStatus::Borrowed, BookStatus::Reserved}) {
+        if (toString(candidate) == name) {
+            status = candidate;
+            return true;
+        }
+    }
+    return false;
+}
+
+#endif
@@ -0,0 +1,264 @@
+#ifndef PREFIX_INDEX_H
+#define PREFIX_INDEX_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <algorithm>
+#include <cstdint>
+
+// Compressed (radix) trie mapping normalized keys, such as titles and author
+// names, to book ids. Nodes and entries live in flat vectors linked by
+// index, and edge labels are slices of one shared buffer, so a node costs
+// 20 bytes. Finding a prefix walks at most its length in labels, and the
+// first k matches are read by a preorder walk that visits O(k) nodes,
+// independent of how many keys share the prefix. Matches come out in
+// lexicographic key order, newest (highest id) book first within a key.
+class PrefixIndex {
+private:
+    static const uint32_t kNone = UINT32_MAX;
+
+    struct Node {
+        uint32_t labelOffset;  // edge label from the parent, in `labels`
+        uint32_t labelLength;
+        uint32_t firstChild;   // siblings are sorted by the first byte of their label
+        uint32_t nextSibling;
+        uint32_t firstEntry;   // books whose key ends at this node, highest id first
+    };
+
+    struct Entry {
+        int bookId;
+        uint32_t next;
+    };
+
+    std::string labels;
+    std::vector<Node> nodes;  // nodes[0] is the root
+    std::vector<uint32_t> freeNodes;
+    std::vector<Entry> entries;
+    std::vector<uint32_t> freeEntries;
+
+    std::string_view labelOf(uint32_t node) const {
+        return std::string_view(labels).substr(nodes[node].labelOffset, nodes[node].labelLength);
+    }
+
+    unsigned char firstByte(uint32_t node) const {
+        return static_cast<unsigned char>(labels[nodes[node].labelOffset]);
+    }
+
+    uint32_t newNode(uint32_t labelOffset, uint32_t labelLength) {
+        Node node = {labelOffset, labelLength, kNone, kNone, kNone};
+        if (!freeNodes.empty()) {
+            uint32_t index = freeNodes.back();
+            freeNodes.pop_back();
+            nodes[index] = node;
+            return index;
+        }
+        nodes.push_back(node);
+        return static_cast<uint32_t>(nodes.size() - 1);
+    }
+
+    uint32_t appendLabel(std::string_view text) {
+        uint32_t offset = static_cast<uint32_t>(labels.size());
+        labels.append(text.data(), text.size());
+        return offset;
+    }
+
+    // Child of `node` whose label starts with `c`; `prev` is left at its
+    // predecessor, or at the last smaller sibling when there is no such child
+    uint32_t findChild(uint32_t node, unsigned char c, uint32_t& prev) const {
+        prev = kNone;
+        uint32_t child = nodes[node].firstChild;
+        while (child != kNone && firstByte(child) < c) {
+            prev = child;
+            child = nodes[child].nextSibling;
+        }
+        return (child != kNone && firstByte(child) == c) ? child : kNone;
+    }
+
+    void linkAfter(uint32_t parent, uint32_t prev, uint32_t child) {
+        uint32_t& slot = prev == kNone ? nodes[parent].firstChild : nodes[prev].nextSibling;
+        nodes[child].nextSibling = slot;
+        slot = child;
+    }
+
+    void unlink(uint32_t parent, uint32_t child) {
+        uint32_t prev = kNone;
+        findChild(parent, firstByte(child), prev);
+        uint32_t& slot = prev == kNone ? nodes[parent].firstChild : nodes[prev].nextSibling;
+        slot = nodes[child].nextSibling;
+    }
+
+    // Keeps the first `length` bytes of the label in `node` and moves the
+    // rest, with the node's children and entries, into a new child
+    void split(uint32_t node, uint32_t length) {
+        uint32_t lower = newNode(nodes[node].labelOffset + length, nodes[node].labelLength - length);
+        nodes[lower].firstChild = nodes[node].firstChild;
+        nodes[lower].firstEntry = nodes[node].firstEntry;
+        nodes[node].labelLength = length;
+        nodes[node].firstChild = lower;
+        nodes[node].firstEntry = kNone;
+    }
+
+    // Folds a node without entries into its only child
+    void mergeWithChild(uint32_t node) {
+        uint32_t child = nodes[node].firstChild;
+        if (nodes[node].labelOffset + nodes[node].labelLength != nodes[child].labelOffset) {
+            std::string joined(labelOf(node));
+            joined.append(labelOf(child));
+            nodes[node].labelOffset = appendLabel(joined);
+        }
+        nodes[node].labelLength += nodes[child].labelLength;
+        nodes[node].firstChild = nodes[child].firstChild;
+        nodes[node].firstEntry = nodes[child].firstEntry;
+        freeNodes.push_back(child);
+    }
+
+    // Books are usually added in id order, which makes this a push at the head
+    void addEntry(uint32_t node, int bookId) {
+        uint32_t prev = kNone;
+        uint32_t next = nodes[node].firstEntry;
+        while (next != kNone && entries[next].bookId > bookId) {
+            prev = next;
+            next = entries[next].next;
+        }
+        if (next != kNone && entries[next].bookId == bookId) return;
+
+        uint32_t index;
+        if (!freeEntries.empty()) {
+            index = freeEntries.back();
+            freeEntries.pop_back();
+            entries[index] = Entry{bookId, next};
+        } else {
+            entries.push_back(Entry{bookId, next});
+            index = static_cast<uint32_t>(entries.size() - 1);
+        }
+        if (prev == kNone) {
+            nodes[node].firstEntry = index;
+        } else {
+            entries[prev].next = index;
+        }
+    }
+
+    bool removeEntry(uint32_t node, int bookId) {
+        for (uint32_t* link = &nodes[node].firstEntry; *link != kNone; link = &entries[*link].next) {
+            if (entries[*link].bookId == bookId) {
+                uint32_t index = *link;
+                *link = entries[index].next;
+                freeEntries.push_back(index);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    size_t childCount(uint32_t node) const {
+        size_t count = 0;
+        for (uint32_t child = nodes[node].firstChild; child != kNone; child = nodes[child].nextSibling) ++count;
+        return count;
+    }
+
+public:
+    PrefixIndex() {
+        clear();
+    }
+
+    void insert(std::string_view key, int bookId) {
+        uint32_t node = 0;
+        size_t pos = 0;
+        while (pos < key.size()) {
+            uint32_t prev;
+            uint32_t child = findChild(node, static_cast<unsigned char>(key[pos]), prev);
+            if (child == kNone) {
+                std::string_view rest = key.substr(pos);
+                uint32_t leaf = newNode(appendLabel(rest), static_cast<uint32_t>(rest.size()));
+                linkAfter(node, prev, leaf);
+                node = leaf;
+                break;
+            }
+            std::string_view label = labelOf(child);
+            uint32_t common = 1;
+            while (common < label.size() && pos + common < key.size() && label[common] == key[pos + common]) {
+                ++common;
+            }
+            if (common < label.size()) split(child, common);
+            node = child;
+            pos += common;
+        }
+        addEntry(node, bookId);
+    }
+
+    void remove(std::string_view key, int bookId) {
+        std::vector<uint32_t> path(1, 0);
+        size_t pos = 0;
+        while (pos < key.size()) {
+            uint32_t prev;
+            uint32_t child = findChild(path.back(), static_cast<unsigned char>(key[pos]), prev);
+            if (child == kNone) return;
+            std::string_view label = labelOf(child);
+            if (key.substr(pos, label.size()) != label) return;
+            path.push_back(child);
+            pos += label.size();
+        }
+        if (!removeEntry(path.back(), bookId)) return;
+
+        // Drop nodes that no longer lead anywhere and re-compress the path
+        while (path.size() > 1) {
+            uint32_t node = path.back();
+            if (nodes[node].firstEntry != kNone) break;
+            size_t children = childCount(node);
+            if (children == 0) {
+                path.pop_back();
+                unlink(path.back(), node);
+                freeNodes.push_back(node);
+                continue;
+            }
+            if (children == 1) mergeWithChild(node);
+            break;
+        }
+    }
+
+    // Up to `limit` book ids whose key starts with `prefix`, in key order
+    std::vector<int> complete(std::string_view prefix, size_t limit) const {
+        std::vector<int> result;
+        uint32_t node = 0;
+        size_t pos = 0;
+        while (pos < prefix.size()) {
+            uint32_t prev;
+            uint32_t child = findChild(node, static_cast<unsigned char>(prefix[pos]), prev);
+            if (child == kNone) return result;
+            std::string_view label = labelOf(child);
+            size_t length = std::min(label.size(), prefix.size() - pos);
+            if (label.substr(0, length) != prefix.substr(pos, length)) return result;
+            node = child;
+            pos += length;
+        }
+
+        // Preorder walk: a node's own entries sort before its children's keys
+        std::vector<uint32_t> stack;
+        stack.push_back(node);
+        bool atStart = true;
+        while (!stack.empty() && result.size() < limit) {
+            uint32_t current = stack.back();
+            stack.pop_back();
+            if (current == kNone) continue;
+            for (uint32_t e = nodes[current].firstEntry; e != kNone && result.size() < limit; e = entries[e].next) {
+                result.push_back(entries[e].bookId);
+            }
+            // The start node's siblings are outside the prefix
+            if (!atStart) stack.push_back(nodes[current].nextSibling);
+            stack.push_back(nodes[current].firstChild);
+            atStart = false;
+        }
+        return result;
+    }
+
+    void clear() {
+        labels.clear();
+        nodes.assign(1, Node{0, 0, kNone, kNone, kNone});
+        freeNodes.clear();
+        entries.clear();
+        freeEntries.clear();
+    }
+};
+
+#endif
@@ -0,0 +1,43 @@
+#ifndef PROTOCOL_H
+#define PROTOCOL_H
+
+#include <string>
+#include <string_view>
+#include <cstddef>
+
+// Line protocol spoken by lms-server over a Unix domain socket. Every
+// request is one line of text and gets one reply line starting with "OK" or
+// "ERR <reason>"; SEARCH replies "OK <n>" followed by n result lines.
+// Requests may be pipelined and are answered in order.
+//
+//   AUTH <userId> <password>  OK <role> <name>      logs the connection in
+//   BORROW <bookId>           OK                    these six act for
+//   RETURN <bookId>           OK                    the logged-in user
+//   RESERVE <bookId>          OK
+//   CANCEL <bookId>           OK
+//   PAY <amount>              OK <fine left>
+//   FINE                      OK <fine owed>
+//   BOOK <bookId>             OK <book>
+//   SEARCH <query>            OK <n>, then n lines of <book>
+//   INFO                      OK <books> <users> <catalog version>
+//   QUIT                      OK, then the server hangs up
+//
+// <book> is id|title|author|publisher|year|isbn|status|borrowed by, as in
+// books.txt. SEARCH takes whatever the menu's search box takes. Replies to
+// requests that changed something are sent only once the change is
+// durable in the journal.
+
+// Where the server listens unless told otherwise
+const char* const kDefaultSocketPath = "lms.sock";
+
+// Longer requests are refused and the connection is closed
+const size_t kMaxRequestLength = 4096;
+
+// Splits a request into its command word and the rest of the line
+inline void splitRequest(std::string_view line, std::string_view& command, std::string_view& argument) {
+    size_t space = line.find(' ');
+    command = line.substr(0, space);
+    argument = space == std::string_view::npos ? std::string_view() : line.substr(space + 1);
+}
+
+#endif
@@ -0,0 +1,242 @@
+#ifndef SCAN_ENGINE_H
+#define SCAN_ENGINE_H
+
+#include "Book.h"
+#include "TextUtil.h"
+#include <string>
+#include <string_view>
+#include <vector>
+#include <algorithm>
+#include <cstring>
+#include <cstdint>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define SCAN_ENGINE_X86 1
+#endif
+
+// Case-insensitive substring scan over book titles, authors and publishers,
+// for "contains" filters the word indexes cannot answer, such as parts of
+// words or punctuation. Every book's fields are kept case-folded in one
+// contiguous buffer as "title\nauthor\npublisher\n", with an offset array
+// marking where each book's record starts. A query can never contain '\n',
+// so a match never spans two fields.
+//
+// Candidates are found by comparing the needle's first and last bytes at 16
+// (SSE2) or 32 (AVX2) positions at once and confirmed with memcmp; the
+// instruction set is picked at run time, with a plain find as the fallback.
+// Removed and updated books leave dead records behind, which are compacted
+// away once they make up half the buffer.
+class ScanEngine {
+public:
+    enum Field : uint8_t { kTitle = 1, kAuthor = 2, kPublisher = 4, kAnyField = 7 };
+    enum class Isa { Scalar, Sse2, Avx2 };
+
+private:
+    static constexpr uint32_t kNone = UINT32_MAX;
+
+    std::string text;
+    std::vector<uint32_t> offsets;   // start of each record in `text`
+    std::vector<int> ids;            // book id of each record, -1 once dead
+    std::vector<uint32_t> recordOf;  // record of each book id
+    size_t deadBytes;
+    bool inIdOrder;  // records ascend by book id, so scans may stop at `limit`
+
+    Isa isa;
+
+    static Isa detectIsa() {
+#ifdef SCAN_ENGINE_X86
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2")) return Isa::Avx2;
+        if (__builtin_cpu_supports("sse2")) return Isa::Sse2;
+#endif
+        return Isa::Scalar;
+    }
+
+    int lastId() const {
+        for (size_t record = ids.size(); record > 0; --record) {
+            if (ids[record - 1] >= 0) return ids[record - 1];
+        }
+        return -1;
+    }
+
+    size_t recordEnd(size_t record) const {
+        return record + 1 < offsets.size() ? offsets[record + 1] : text.size();
+    }
+
+    void append(const Book& book) {
+        int bookId = book.getBookId();
+        if (static_cast<size_t>(bookId) >= recordOf.size()) recordOf.resize(static_cast<size_t>(bookId) + 1, kNone);
+        if (!ids.empty() && lastId() > bookId) inIdOrder = false;
+        recordOf[bookId] = static_cast<uint32_t>(ids.size());
+        offsets.push_back(static_cast<uint32_t>(text.size()));
+        ids.push_back(bookId);
+        for (const std::string* field : {&book.getTitle(), &book.getAuthor(), &book.getPublisher()}) {
+            size_t start = text.size();
+            text += *field;
+            for (size_t i = start; i < text.size(); ++i) {
+                text[i] = text[i] == '\n' ? ' ' : foldCase(text[i]);
+            }
+            text += '\n';
+        }
+    }
+
+    // Drops dead records, keeping the live ones in their current order
+    void compact() {
+        std::string live;
+        std::vector<uint32_t> liveOffsets;
+        std::vector<int> liveIds;
+        live.reserve(text.size() - deadBytes);
+        for (size_t record = 0; record < ids.size(); ++record) {
+            if (ids[record] < 0) continue;
+            recordOf[ids[record]] = static_cast<uint32_t>(liveIds.size());
+            liveOffsets.push_back(static_cast<uint32_t>(live.size()));
+            liveIds.push_back(ids[record]);
+            live.append(text, offsets[record], recordEnd(record) - offsets[record]);
+        }
+        text.swap(live);
+        offsets.swap(liveOffsets);
+        ids.swap(liveIds);
+        deadBytes = 0;
+        inIdOrder = std::is_sorted(ids.begin(), ids.end());
+    }
+
+    // Position of the first occurrence of `needle` (two bytes or longer)
+    // starting in [from, last], or kNone. Each variant handles whole blocks
+    // and leaves the tail to findScalar.
+    size_t findScalar(std::string_view needle, size_t from, size_t last) const {
+        size_t pos = std::string_view(text).find(needle, from);
+        return pos <= last ? pos : kNone;
+    }
+
+#ifdef SCAN_ENGINE_X86
+#ifdef __SSE2__
+    size_t findSse2(std::string_view needle, size_t from, size_t last) const {
+        const char* data = text.data();
+        size_t n = needle.size();
+        const __m128i first = _mm_set1_epi8(needle[0]);
+        const __m128i lastByte = _mm_set1_epi8(needle[n - 1]);
+        for (; from + 16 <= last + 1; from += 16) {
+            __m128i head = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + from));
+            __m128i tail = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + from + n - 1));
+            unsigned mask = static_cast<unsigned>(
+                _mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(head, first), _mm_cmpeq_epi8(tail, lastByte))));
+            while (mask) {
+                size_t pos = from + static_cast<size_t>(__builtin_ctz(mask));
+                if (std::memcmp(data + pos + 1, needle.data() + 1, n - 2) == 0) return pos;
+                mask &= mask - 1;
+            }
+        }
+        return findScalar(needle, from, last);
+    }
+#endif
+
+    __attribute__((target("avx2")))
+    size_t findAvx2(std::string_view needle, size_t from, size_t last) const {
+        const char* data = text.data();
+        size_t n = needle.size();
+        const __m256i first = _mm256_set1_epi8(needle[0]);
+        const __m256i lastByte = _mm256_set1_epi8(needle[n - 1]);
+        for (; from + 32 <= last + 1; from += 32) {
+            __m256i head = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + from));
+            __m256i tail = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + from + n - 1));
+            unsigned mask = static_cast<unsigned>(_mm256_movemask_epi8(
+                _mm256_and_si256(_mm256_cmpeq_epi8(head, first), _mm256_cmpeq_epi8(tail, lastByte))));
+            while (mask) {
+                size_t pos = from + static_cast<size_t>(__builtin_ctz(mask));
+                if (std::memcmp(data + pos + 1, needle.data() + 1, n - 2) == 0) return pos;
+                mask &= mask - 1;
+            }
+        }
+        return findScalar(needle, from, last);
+    }
+#endif
+
+    size_t findFrom(std::string_view needle, size_t from) const {
+        if (text.size() < needle.size() || from > text.size() - needle.size()) return kNone;
+        size_t last = text.size() - needle.size();
+        if (needle.size() == 1) {
+            const void* hit = std::memchr(text.data() + from, needle[0], last + 1 - from);
+            return hit ? static_cast<size_t>(static_cast<const char*>(hit) - text.data()) : kNone;
+        }
+#ifdef SCAN_ENGINE_X86
+        if (isa == Isa::Avx2) return findAvx2(needle, from, last);
+#ifdef __SSE2__
+        if (isa == Isa::Sse2) return findSse2(needle, from, last);
+#endif
+#endif
+        return findScalar(needle, from, last);
+    }
+
+public:
+    ScanEngine() : deadBytes(0), inIdOrder(true), isa(detectIsa()) {}
+
+    // The kernel find() uses. setIsa can only step down from what the CPU
+    // supports, to compare the kernels on one machine.
+    Isa getIsa() const { return isa; }
+    void setIsa(Isa wanted) { isa = std::min(wanted, detectIsa()); }
+
+    void add(const Book& book) {
+        remove(book.getBookId());
+        append(book);
+    }
+
+    void remove(int bookId) {
+        if (bookId < 0 || static_cast<size_t>(bookId) >= recordOf.size() || recordOf[bookId] == kNone) return;
+        uint32_t record = recordOf[bookId];
+        recordOf[bookId] = kNone;
+        ids[record] = -1;
+        deadBytes += recordEnd(record) - offsets[record];
+        if (deadBytes * 2 > text.size()) compact();
+    }
+
+    void clear() {
+        text.clear();
+        offsets.clear();
+        ids.clear();
+        recordOf.clear();
+        deadBytes = 0;
+        inIdOrder = true;
+    }
+
+    // Ids of up to `limit` books with `needle` in one of the given fields,
+    // in ascending id order. An empty needle, or one spanning lines,
+    // matches nothing.
+    std::vector<int> find(std::string_view needle, uint8_t fields = kAnyField,
+                          size_t limit = SIZE_MAX) const {
+        std::vector<int> found;
+        if (needle.empty() || needle.find('\n') != std::string_view::npos) return found;
+        std::string folded = foldCase(needle);
+
+        size_t record = 0;
+        size_t pos = findFrom(folded, 0);
+        while (pos != kNone && !(inIdOrder && found.size() == limit)) {
+            // Matches come in buffer order; dense ones land in the next record
+            if (recordEnd(record) <= pos) ++record;
+            if (recordEnd(record) <= pos) {
+                record = static_cast<size_t>(std::upper_bound(offsets.begin() + record, offsets.end(),
+                                                              static_cast<uint32_t>(pos)) - offsets.begin() - 1);
+            }
+            size_t next = recordEnd(record);
+            if (ids[record] >= 0) {
+                // Field number = line of the record the match sits on
+                const char* start = text.data() + offsets[record];
+                size_t line = static_cast<size_t>(std::count(start, text.data() + pos, '\n'));
+                if (fields & (1u << line)) {
+                    found.push_back(ids[record]);
+                } else {
+                    // Keep looking further in this record
+                    next = pos + 1;
+                }
+            }
+            pos = findFrom(folded, next);
+        }
+        if (!inIdOrder) {
+            std::sort(found.begin(), found.end());
+            if (found.size() > limit) found.resize(limit);
+        }
+        return found;
+    }
+};
+
+#endif
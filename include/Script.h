@@ -0,0 +1,110 @@
+#ifndef SCRIPT_H
+#define SCRIPT_H
+
+#include "Library.h"
+#include <string>
+#include <string_view>
+#include <vector>
+#include <istream>
+#include <ostream>
+#include <streambuf>
+
+// Collects output and passes it on to `target` in large blocks. sync(),
+// which std::endl and std::flush call, does nothing, so the per-line
+// flushes in the library cost no write; call drain() to write everything.
+class BufferedOutput : public std::streambuf {
+private:
+    std::streambuf* target;
+    std::vector<char> buffer;
+
+    void writeOut() {
+        target->sputn(pbase(), pptr() - pbase());
+        setp(buffer.data(), buffer.data() + buffer.size());
+    }
+
+protected:
+    int overflow(int c) override {
+        writeOut();
+        if (c != traits_type::eof()) {
+            *pptr() = static_cast<char>(c);
+            pbump(1);
+        }
+        return traits_type::not_eof(c);
+    }
+    int sync() override { return 0; }
+
+public:
+    explicit BufferedOutput(std::streambuf* target, size_t size = 1 << 16) : target(target), buffer(size) {
+        setp(buffer.data(), buffer.data() + buffer.size());
+    }
+    ~BufferedOutput() override { drain(); }
+
+    void drain() {
+        writeOut();
+        target->pubsync();
+    }
+};
+
+// Headless replay of a command script against a Library, one command per
+// line; blank lines and lines starting with # are skipped.
+//
+//   borrow <userId> <bookId>        return <userId> <bookId>
+//   reserve <userId> <bookId>       cancel <userId> <bookId>
+//   pay <userId> <amount>           fine <userId>
+//   book <bookId>                   search <query>
+//   adduser id|name|email|password|type
+//   addbook title|author|publisher|year|isbn
+//   removeuser <userId>             removebook <bookId>
+//   fines                           holds
+//   flush
+//   batch ... end                   borrow, return and reserve lines in
+//                                   between run as one Library::applyBatch
+//
+// Commands act for the user named on the line; no login is needed. Queries
+// print their results and failed commands print an error naming the line.
+// Fines and reservation holds are only swept by the fines and holds
+// commands, not after every command as in the menus. Everything is written
+// to the output stream, which is best given a buffer that does not flush
+// on std::endl, since the library itself writes to std::cout.
+class ScriptRunner {
+public:
+    ScriptRunner(Library& lib, std::ostream& out);
+
+    // Runs every line of `in`; returns false if any command failed
+    bool run(std::istream& in);
+
+    // Command counts, failures and throughput since construction
+    void report(std::ostream& out, double wallSeconds) const;
+
+private:
+    enum Command {
+        kBorrow, kReturn, kReserve, kCancel, kPay, kFine, kBook, kSearch,
+        kAddUser, kAddBook, kRemoveUser, kRemoveBook, kFines, kHolds, kFlush, kBatch,
+        kCommandCount
+    };
+
+    struct CommandStats {
+        size_t count = 0;   // commands, or for batch the requests in batches
+        size_t failed = 0;
+        double seconds = 0;
+    };
+
+    Library& lib;
+    std::ostream& out;
+    size_t lineNumber;
+    CommandStats stats[kCommandCount];
+
+    // The open batch, if any, and the line of each request in it
+    bool inBatch;
+    size_t batchLine;
+    std::vector<CirculationRequest> batch;
+    std::vector<size_t> batchLines;
+
+    bool execute(std::string_view line);
+    bool dispatch(Command command, std::string_view arguments);
+    bool queue(Command command, std::string_view arguments);
+    bool applyBatch();
+    bool fail(std::string_view message);
+};
+
+#endif
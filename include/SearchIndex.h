@@ -0,0 +1,430 @@
+#ifndef SEARCH_INDEX_H
+#define SEARCH_INDEX_H
+
+#include "Book.h"
+#include "TextUtil.h"
+#include "TrigramIndex.h"
+#include <string>
+#include <string_view>
+#include <vector>
+#include <algorithm>
+#include <utility>
+#include <cmath>
+#include <cstdint>
+
+struct SearchHit {
+    int bookId;
+    double score;
+};
+
+// Inverted index over book titles, authors and publishers. Terms are
+// interned into a dense id space by an open-addressing dictionary whose
+// strings share one buffer; each term id owns a posting list sorted by book
+// id that records which fields contained the term.
+//
+// Queries are whitespace-separated words that must all match (AND); the
+// keyword OR separates alternatives, so "tolkien hobbit OR rowling" finds
+// books matching both "tolkien" and "hobbit", or "rowling". Hits are ranked
+// by the field weight of every matched term (title > author > publisher)
+// times its inverse document frequency.
+//
+// searchFuzzy tolerates typos in titles and authors: a trigram index over
+// the terms proposes spellings for each query word, which are confirmed by
+// a bounded edit distance before their posting lists are used.
+class SearchIndex {
+private:
+    enum Field : uint8_t { kTitle = 1, kAuthor = 2, kPublisher = 4 };
+
+    struct Posting {
+        int bookId;
+        uint8_t fields;
+    };
+
+    typedef std::vector<Posting> PostingList;
+    typedef std::vector<std::pair<uint32_t, uint8_t>> TermList;  // term id, fields
+
+    struct TermSlot {
+        uint64_t hash;  // 0 marks an empty slot
+        uint32_t termId;
+    };
+
+    static const uint32_t kNoTerm = UINT32_MAX;
+
+    std::vector<TermSlot> table;
+    std::string termText;               // every term, back to back
+    std::vector<uint32_t> termOffsets;  // term id -> start in termText, plus an end sentinel
+    std::vector<PostingList> postings;  // by term id
+    TrigramIndex trigrams;              // over terms that have postings
+    size_t documentCount;
+
+    static uint64_t hashTerm(std::string_view term) {
+        uint64_t hash = 14695981039346656037ULL;  // FNV-1a
+        for (char c : term) {
+            hash = (hash ^ static_cast<unsigned char>(c)) * 1099511628211ULL;
+        }
+        return hash | 1;
+    }
+
+    size_t mask() const { return table.size() - 1; }
+    size_t home(uint64_t hash) const { return (hash ^ (hash >> 29)) & mask(); }
+
+    std::string_view termAt(uint32_t termId) const {
+        return std::string_view(termText).substr(termOffsets[termId], termOffsets[termId + 1] - termOffsets[termId]);
+    }
+
+    uint32_t findTerm(std::string_view term) const {
+        if (table.empty()) return kNoTerm;
+        uint64_t hash = hashTerm(term);
+        for (size_t i = home(hash);; i = (i + 1) & mask()) {
+            if (table[i].hash == 0) return kNoTerm;
+            if (table[i].hash == hash && termAt(table[i].termId) == term) return table[i].termId;
+        }
+    }
+
+    void growTable() {
+        std::vector<TermSlot> old;
+        old.swap(table);
+        table.assign(old.empty() ? 1024 : old.size() * 2, TermSlot{0, 0});
+        for (const TermSlot& slot : old) {
+            if (slot.hash == 0) continue;
+            size_t i = home(slot.hash);
+            while (table[i].hash != 0) i = (i + 1) & mask();
+            table[i] = slot;
+        }
+    }
+
+    uint32_t internTerm(std::string_view term) {
+        if ((postings.size() + 1) * 10 > table.size() * 7) growTable();
+        uint64_t hash = hashTerm(term);
+        size_t i = home(hash);
+        for (; table[i].hash != 0; i = (i + 1) & mask()) {
+            if (table[i].hash == hash && termAt(table[i].termId) == term) return table[i].termId;
+        }
+        uint32_t termId = static_cast<uint32_t>(postings.size());
+        table[i] = TermSlot{hash, termId};
+        if (termOffsets.empty()) termOffsets.push_back(0);
+        termText.append(term.data(), term.size());
+        termOffsets.push_back(static_cast<uint32_t>(termText.size()));
+        postings.emplace_back();
+        return termId;
+    }
+
+    // Distinct terms of a book with the fields they occur in. Unknown terms
+    // are created only when `create` is set.
+    TermList termsOf(const Book& book, bool create) {
+        TermList terms;
+        auto collect = [this, &terms, create](const std::string& text, uint8_t field) {
+            forEachToken(text, [this, &terms, create, field](const std::string& token) {
+                uint32_t termId = create ? internTerm(token) : findTerm(token);
+                if (termId != kNoTerm) terms.emplace_back(termId, field);
+            });
+        };
+        collect(book.getTitle(), kTitle);
+        collect(book.getAuthor(), kAuthor);
+        collect(book.getPublisher(), kPublisher);
+
+        std::sort(terms.begin(), terms.end());
+        size_t out = 0;
+        for (size_t i = 0; i < terms.size(); ++i) {
+            if (out > 0 && terms[out - 1].first == terms[i].first) {
+                terms[out - 1].second |= terms[i].second;
+            } else {
+                terms[out++] = terms[i];
+            }
+        }
+        terms.resize(out);
+        return terms;
+    }
+
+    // First posting at or after `from` whose book id is >= bookId. Gallops
+    // ahead before binary searching, so walking a list in order is linear.
+    static PostingList::const_iterator seek(const PostingList& list, PostingList::const_iterator from, int bookId) {
+        size_t step = 1;
+        PostingList::const_iterator low = from;
+        while (static_cast<size_t>(list.end() - low) > step && (low + step)->bookId < bookId) {
+            low += step;
+            step *= 2;
+        }
+        PostingList::const_iterator high = static_cast<size_t>(list.end() - low) > step ? low + step + 1 : list.end();
+        return std::lower_bound(low, high, bookId, [](const Posting& p, int id) { return p.bookId < id; });
+    }
+
+    static double fieldWeight(uint8_t fields) {
+        return ((fields & kTitle) ? 3.0 : 0.0) + ((fields & kAuthor) ? 2.0 : 0.0) +
+               ((fields & kPublisher) ? 1.0 : 0.0);
+    }
+
+    double idf(const PostingList& list) const {
+        return std::log(1.0 + static_cast<double>(documentCount) / static_cast<double>(list.size()));
+    }
+
+    // Calls onHit for every book containing all terms of one AND group, in id order
+    template <typename F>
+    void matchGroup(const std::vector<std::string>& terms, F onHit) const {
+        std::vector<const PostingList*> lists;
+        for (const std::string& term : terms) {
+            uint32_t termId = findTerm(term);
+            if (termId == kNoTerm || postings[termId].empty()) return;
+            lists.push_back(&postings[termId]);
+        }
+        if (lists.empty()) return;
+
+        // Drive the intersection from the rarest term
+        std::sort(lists.begin(), lists.end(),
+                  [](const PostingList* a, const PostingList* b) { return a->size() < b->size(); });
+        std::vector<double> weights;
+        for (const PostingList* list : lists) weights.push_back(idf(*list));
+        std::vector<PostingList::const_iterator> cursors;
+        for (const PostingList* list : lists) cursors.push_back(list->begin());
+
+        for (const Posting& lead : *lists[0]) {
+            double score = weights[0] * fieldWeight(lead.fields);
+            bool matched = true;
+            for (size_t i = 1; i < lists.size(); ++i) {
+                cursors[i] = seek(*lists[i], cursors[i], lead.bookId);
+                if (cursors[i] == lists[i]->end()) return;
+                if (cursors[i]->bookId != lead.bookId) {
+                    matched = false;
+                    break;
+                }
+                score += weights[i] * fieldWeight(cursors[i]->fields);
+            }
+            if (matched) onHit(SearchHit{lead.bookId, score});
+        }
+    }
+
+    static bool ranksBefore(const SearchHit& a, const SearchHit& b) {
+        return a.score != b.score ? a.score > b.score : a.bookId < b.bookId;
+    }
+
+    // Splits a query into OR-separated groups of distinct, case-folded words
+    static std::vector<std::vector<std::string>> parseQuery(std::string_view query) {
+        std::vector<std::vector<std::string>> groups(1);
+        size_t pos = 0;
+        while (pos < query.size()) {
+            size_t end = query.find_first_of(" \t", pos);
+            if (end == std::string_view::npos) end = query.size();
+            std::string_view word = query.substr(pos, end - pos);
+            pos = end + 1;
+            if (word == "OR") {
+                if (!groups.back().empty()) groups.emplace_back();
+            } else if (word != "AND") {
+                forEachToken(word, [&groups](const std::string& token) {
+                    std::vector<std::string>& group = groups.back();
+                    if (std::find(group.begin(), group.end(), token) == group.end()) group.push_back(token);
+                });
+            }
+        }
+        if (groups.size() > 1 && groups.back().empty()) groups.pop_back();
+        return groups;
+    }
+
+    // Keeps the best `limit` hits in a heap whose top is the worst of them
+    static void keepBest(std::vector<SearchHit>& heap, const SearchHit& hit, size_t limit) {
+        if (heap.size() < limit) {
+            heap.push_back(hit);
+            std::push_heap(heap.begin(), heap.end(), ranksBefore);
+        } else if (limit > 0 && ranksBefore(hit, heap.front())) {
+            std::pop_heap(heap.begin(), heap.end(), ranksBefore);
+            heap.back() = hit;
+            std::push_heap(heap.begin(), heap.end(), ranksBefore);
+        }
+    }
+
+    // Ranks hits gathered from several OR groups; a book matched by more
+    // than one group keeps its best score
+    static std::vector<SearchHit> bestOfGroups(std::vector<SearchHit>& all, size_t limit) {
+        std::sort(all.begin(), all.end(), [](const SearchHit& a, const SearchHit& b) {
+            return a.bookId != b.bookId ? a.bookId < b.bookId : a.score > b.score;
+        });
+        std::vector<SearchHit> heap;
+        for (size_t i = 0; i < all.size(); ++i) {
+            if (i == 0 || all[i].bookId != all[i - 1].bookId) keepBest(heap, all[i], limit);
+        }
+        std::sort_heap(heap.begin(), heap.end(), ranksBefore);
+        return heap;
+    }
+
+    // Typos allowed in a query word of the given length. Words keep more
+    // distinct trigrams than the budget can destroy, so the trigram filter
+    // loses nothing.
+    static size_t typoBudget(size_t length) {
+        return length <= 4 ? 0 : (length <= 8 ? 1 : 2);
+    }
+
+    // Terms with title or author postings within the typo budget of `word`,
+    // closest and then most frequent first
+    std::vector<std::pair<uint32_t, size_t>> spellings(const std::string& word) const {
+        std::vector<std::pair<uint32_t, size_t>> terms;  // term id, distance
+        size_t budget = typoBudget(word.size());
+        uint32_t exact = findTerm(word);
+        if (exact != kNoTerm && !postings[exact].empty()) terms.emplace_back(exact, 0);
+        if (budget > 0) {
+            for (uint32_t termId : trigrams.candidates(word, budget)) {
+                if (termId == exact) continue;
+                size_t distance = boundedEditDistance(word, termAt(termId), budget);
+                if (distance <= budget) terms.emplace_back(termId, distance);
+            }
+        }
+        std::sort(terms.begin(), terms.end(), [this](const std::pair<uint32_t, size_t>& a,
+                                                      const std::pair<uint32_t, size_t>& b) {
+            if (a.second != b.second) return a.second < b.second;
+            return postings[a.first].size() > postings[b.first].size();
+        });
+        return terms;
+    }
+
+    // Books whose title or author contains one of the spellings, in id
+    // order; each keeps its best contribution, discounted by edit distance
+    std::vector<SearchHit> fuzzyMatches(const std::vector<std::pair<uint32_t, size_t>>& terms) const {
+        std::vector<SearchHit> hits;
+        for (const auto& term : terms) {
+            const PostingList& list = postings[term.first];
+            double weight = idf(list) / static_cast<double>(1 + term.second);
+            for (const Posting& posting : list) {
+                uint8_t fields = posting.fields & (kTitle | kAuthor);
+                if (fields) hits.push_back(SearchHit{posting.bookId, weight * fieldWeight(fields)});
+            }
+        }
+        if (terms.size() > 1) {
+            std::sort(hits.begin(), hits.end(), [](const SearchHit& a, const SearchHit& b) {
+                return a.bookId != b.bookId ? a.bookId < b.bookId : a.score > b.score;
+            });
+            hits.erase(std::unique(hits.begin(), hits.end(),
+                                   [](const SearchHit& a, const SearchHit& b) { return a.bookId == b.bookId; }),
+                       hits.end());
+        }
+        return hits;
+    }
+
+    // Drops the id-ordered hits whose title and author contain none of the
+    // spellings, and adds the best contribution to the rest
+    void refine(std::vector<SearchHit>& hits, const std::vector<std::pair<uint32_t, size_t>>& terms) const {
+        std::vector<PostingList::const_iterator> cursors;
+        std::vector<double> weights;
+        for (const auto& term : terms) {
+            cursors.push_back(postings[term.first].begin());
+            weights.push_back(idf(postings[term.first]) / static_cast<double>(1 + term.second));
+        }
+
+        size_t kept = 0;
+        for (const SearchHit& hit : hits) {
+            double best = 0.0;
+            for (size_t i = 0; i < terms.size(); ++i) {
+                const PostingList& list = postings[terms[i].first];
+                cursors[i] = seek(list, cursors[i], hit.bookId);
+                if (cursors[i] == list.end() || cursors[i]->bookId != hit.bookId) continue;
+                uint8_t fields = cursors[i]->fields & (kTitle | kAuthor);
+                if (fields) best = std::max(best, weights[i] * fieldWeight(fields));
+            }
+            if (best > 0.0) hits[kept++] = SearchHit{hit.bookId, hit.score + best};
+        }
+        hits.resize(kept);
+    }
+
+public:
+    SearchIndex() : documentCount(0) {}
+
+    void add(const Book& book) {
+        int bookId = book.getBookId();
+        for (const auto& term : termsOf(book, true)) {
+            PostingList& list = postings[term.first];
+            if (list.empty()) trigrams.add(term.first, termAt(term.first));
+            if (list.empty() || list.back().bookId < bookId) {
+                list.push_back(Posting{bookId, term.second});
+                continue;
+            }
+            auto it = seek(list, list.begin(), bookId);
+            if (it != list.end() && it->bookId == bookId) {
+                list[it - list.begin()].fields |= term.second;
+            } else {
+                list.insert(it, Posting{bookId, term.second});
+            }
+        }
+        ++documentCount;
+    }
+
+    // Must be called with the text the book was indexed under. Terms stay
+    // in the dictionary after their last posting is gone.
+    void remove(const Book& book) {
+        int bookId = book.getBookId();
+        for (const auto& term : termsOf(book, false)) {
+            PostingList& list = postings[term.first];
+            auto it = seek(list, list.begin(), bookId);
+            if (it != list.end() && it->bookId == bookId) list.erase(it);
+            if (list.empty()) trigrams.remove(term.first, termAt(term.first));
+        }
+        if (documentCount > 0) --documentCount;
+    }
+
+    void clear() {
+        table.clear();
+        termText.clear();
+        termOffsets.clear();
+        postings.clear();
+        trigrams.clear();
+        documentCount = 0;
+    }
+
+    // Best `limit` hits, highest score first
+    std::vector<SearchHit> search(std::string_view query, size_t limit) const {
+        std::vector<std::vector<std::string>> groups = parseQuery(query);
+        if (groups.size() > 1) {
+            std::vector<SearchHit> all;
+            for (const auto& group : groups) {
+                matchGroup(group, [&all](const SearchHit& hit) { all.push_back(hit); });
+            }
+            return bestOfGroups(all, limit);
+        }
+
+        std::vector<SearchHit> heap;
+        matchGroup(groups[0], [&heap, limit](const SearchHit& hit) { keepBest(heap, hit, limit); });
+        std::sort_heap(heap.begin(), heap.end(), ranksBefore);
+        return heap;
+    }
+
+    // Like search, but each word may match a title or author word with a
+    // few typos. `suggestion` receives the query spelled with the closest
+    // known words, or is left empty when every word was found as typed.
+    std::vector<SearchHit> searchFuzzy(std::string_view query, size_t limit, std::string& suggestion) const {
+        suggestion.clear();
+        bool corrected = false;
+        std::vector<std::vector<std::string>> groups = parseQuery(query);
+        std::vector<SearchHit> all;
+        for (const auto& group : groups) {
+            std::vector<std::vector<std::pair<uint32_t, size_t>>> terms;
+            std::vector<std::pair<size_t, size_t>> order;  // postings to scan, word index
+            if (!suggestion.empty()) suggestion += " OR";
+            for (const std::string& word : group) {
+                terms.push_back(spellings(word));
+                const auto& spelled = terms.back();
+                if (!suggestion.empty()) suggestion += ' ';
+                if (spelled.empty() || spelled[0].second > 0) corrected = true;
+                suggestion += spelled.empty() ? word : std::string(termAt(spelled[0].first));
+
+                size_t cost = 0;
+                for (const auto& term : spelled) cost += postings[term.first].size();
+                order.emplace_back(cost, terms.size() - 1);
+            }
+            if (order.empty()) continue;
+
+            // Start from the word with the fewest postings and narrow it down
+            std::sort(order.begin(), order.end());
+            std::vector<SearchHit> matched = fuzzyMatches(terms[order[0].second]);
+            for (size_t i = 1; i < order.size() && !matched.empty(); ++i) {
+                refine(matched, terms[order[i].second]);
+            }
+            all.insert(all.end(), matched.begin(), matched.end());
+        }
+        if (!corrected) suggestion.clear();
+        if (groups.size() > 1) return bestOfGroups(all, limit);
+
+        // A single group's hits are already distinct
+        std::vector<SearchHit> heap;
+        for (const SearchHit& hit : all) keepBest(heap, hit, limit);
+        std::sort_heap(heap.begin(), heap.end(), ranksBefore);
+        return heap;
+    }
+};
+
+#endif
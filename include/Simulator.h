@@ -0,0 +1,95 @@
+#ifndef SIMULATOR_H
+#define SIMULATOR_H
+
+#include "Clock.h"
+#include "TimerQueue.h"
+#include <string>
+#include <vector>
+#include <random>
+#include <ostream>
+#include <ctime>
+#include <set>
+
+class Library;
+
+// Shape of the generated semester
+struct SimulationConfig {
+    int days = 120;
+    int students = 2000;
+    int faculty = 200;
+    int books = 5000;
+    double visitsPerDay = 0.5;    // average library visits per patron per day
+    unsigned seed = 1;
+
+    // Concurrent mode: instead of the semester, run `operations` random
+    // circulation calls split across each of these thread counts
+    std::vector<int> threadCounts;
+    int operations = 100000;
+};
+
+// Discrete-event replay of a semester of borrowing, returning, reserving
+// and fine payments against a real Library, in virtual time. Events sit in
+// a timer queue keyed by their virtual time; the clock jumps straight to
+// each event, so a semester runs as fast as the library can serve it. Every
+// Library call is timed, and the report gives per-operation throughput and
+// latency percentiles for capacity planning.
+//
+// The concurrent mode is a stress test and throughput benchmark instead:
+// worker threads borrow, return, reserve and pay fines as fast as they can
+// on shared books, each for its own share of the patrons, while one of them
+// also advances the clock and runs the daily sweeps. Afterwards the books,
+// accounts, reservation queues and published catalog are checked against
+// each other and against what the workers saw, and a copy of the database is reloaded from
+// its journal and compared, so lost or torn updates show up as failures.
+class Simulator {
+public:
+    explicit Simulator(const SimulationConfig& config);
+
+    // Runs the semester, or the concurrent benchmark when thread counts are
+    // given, and writes the report to `out`
+    void run(std::ostream& out);
+
+private:
+    enum Operation { kBorrow, kReturn, kReserve, kPayFine, kFineSweep, kHoldSweep, kOperationCount };
+
+    enum class EventType { Visit, Return, DailySweep };
+
+    struct Event {
+        EventType type;
+        int patron;  // index into `patrons`
+        int bookId;
+    };
+
+    struct OperationStats {
+        std::vector<double> micros;  // latency of every call
+        size_t succeeded = 0;
+    };
+
+    SimulationConfig config;
+    VirtualClock clock;
+    std::mt19937 rng;
+    TimerQueue<Event> events;
+    std::vector<std::string> patrons;
+    std::vector<int> bookIds;
+    OperationStats stats[kOperationCount];
+
+    void populate(Library& lib);
+    void handle(Library& lib, const Event& event);
+    void visit(Library& lib, int patron);
+    bool borrow(Library& lib, int patron, int bookId);
+    int pickBook(std::mt19937& random) const;
+    time_t randomDelay(double meanDays);
+
+    void runConcurrent(std::ostream& out);
+    void work(Library& lib, int worker, int workers, int operations, std::vector<std::set<int>>& loans);
+    std::string verify(const Library& lib, const std::vector<std::set<int>>& loans) const;
+    std::string state(const Library& lib) const;
+
+    // Runs f(), recording its latency and whether it reported success
+    template <typename F>
+    bool timed(Operation operation, F f);
+
+    void report(std::ostream& out, double wallSeconds, size_t eventCount) const;
+};
+
+#endif
@@ -0,0 +1,136 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include "User.h"
+#include "Book.h"
+#include "BookStore.h"
+#include "Account.h"
+#include "DurableFile.h"
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+// Binary snapshot of the whole library (data/library.snap).
+//
+// Layout: a fixed header followed by fixed-width record arrays for users,
+// books and accounts, an array of borrowed book ids, and one string heap.
+// Strings are stored as (offset, length) pairs into the heap, so a mapped
+// snapshot can be read without tokenizing or converting any field.
+//
+// Every checkpoint has a generation number. The header records it together
+// with the fingerprints of the text files written in the same checkpoint;
+// the snapshot stands in for the text files only while they still match.
+namespace snapshot {
+
+const char kMagic[8] = {'L', 'M', 'S', 'S', 'N', 'A', 'P', '\0'};
+const uint32_t kVersion = 3;
+
+struct StrRef {
+    uint32_t offset;
+    uint32_t length;
+};
+
+// The text files of one checkpoint, in the order users, books, accounts
+enum TextFile { kUsersFile, kBooksFile, kAccountsFile, kTextFileCount };
+
+// What a checkpoint wrote besides the snapshot
+struct Checkpoint {
+    uint64_t generation;
+    FileFingerprint textFiles[kTextFileCount];
+};
+
+struct Header {
+    char magic[8];
+    uint32_t version;
+    uint32_t reserved;
+    Checkpoint checkpoint;
+    uint64_t userCount;
+    uint64_t bookCount;
+    uint64_t accountCount;
+    uint64_t loanCount;
+    uint64_t heapSize;
+    uint64_t usersOffset;
+    uint64_t booksOffset;
+    uint64_t accountsOffset;
+    uint64_t loansOffset;
+    uint64_t heapOffset;
+};
+
+struct UserRecord {
+    StrRef id;
+    StrRef name;
+    StrRef email;
+    StrRef password;
+    uint8_t role;  // Role
+    uint8_t padding[3];
+};
+
+struct BookRecord {
+    int32_t id;
+    int32_t year;
+    StrRef title;
+    StrRef author;
+    StrRef publisher;
+    StrRef isbn;
+    StrRef borrowedBy;
+    uint8_t status;  // BookStatus
+    uint8_t padding[7];
+};
+
+struct AccountRecord {
+    StrRef userId;
+    double totalFine;
+    uint32_t firstLoan;  // index into the loan array
+    uint32_t loanCount;
+    uint8_t finePaid;
+    uint8_t padding[7];
+};
+
+// Read-only view of a memory-mapped snapshot file
+class Reader {
+private:
+    const char* base;
+    size_t size;
+    const Header* header;
+
+    template <typename T>
+    const T* section(uint64_t offset) const {
+        return reinterpret_cast<const T*>(base + offset);
+    }
+
+public:
+    Reader();
+    ~Reader();
+
+    Reader(const Reader&) = delete;
+    Reader& operator=(const Reader&) = delete;
+
+    // Maps the file and validates its header; false if missing or corrupt
+    bool open(const std::string& path);
+    void close();
+
+    size_t userCount() const { return header ? header->userCount : 0; }
+    size_t bookCount() const { return header ? header->bookCount : 0; }
+    size_t accountCount() const { return header ? header->accountCount : 0; }
+    const Checkpoint& checkpoint() const { return header->checkpoint; }
+
+    const UserRecord& user(size_t i) const { return section<UserRecord>(header->usersOffset)[i]; }
+    const BookRecord& book(size_t i) const { return section<BookRecord>(header->booksOffset)[i]; }
+    const AccountRecord& account(size_t i) const { return section<AccountRecord>(header->accountsOffset)[i]; }
+    int32_t loan(size_t i) const { return section<int32_t>(header->loansOffset)[i]; }
+
+    std::string_view str(const StrRef& ref) const {
+        if (static_cast<uint64_t>(ref.offset) + ref.length > header->heapSize) return std::string_view();
+        return std::string_view(base + header->heapOffset + ref.offset, ref.length);
+    }
+};
+
+// Writes a snapshot atomically (DurableFile); the caller syncs the directory
+bool write(const std::string& path, const Checkpoint& checkpoint, const std::vector<User*>& users,
+           const BookStore& books, const std::vector<Account*>& accounts);
+
+} // namespace snapshot
+
+#endif
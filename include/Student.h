@@ -6,13 +6,7 @@
 class Student : public User {
 public:
     Student(const std::string& name, const std::string& email, const std::string& id)
-        : User(name, email, id) {
-        role = "Student";
-        maxBorrowLimit = 3;
-        maxBorrowPeriod = 15;  // 15 days
-    }
-
-    bool canBorrowBook() const override { return true; }
+        : User(name, email, id, Role::Student) {}
 };
 
-#endif 
\ No newline at end of file
+#endif
@@ -0,0 +1,80 @@
+#ifndef TEXT_UTIL_H
+#define TEXT_UTIL_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <algorithm>
+
+// Case folding and word splitting shared by the catalog indexes. Only ASCII
+// letters are folded; bytes of multi-byte UTF-8 characters are kept as-is
+// and count as word characters.
+
+inline char foldCase(char c) {
+    return (c >= 'A' && c <= 'Z') ? static_cast<char>(c - 'A' + 'a') : c;
+}
+
+inline std::string foldCase(std::string_view text) {
+    std::string folded(text);
+    for (char& c : folded) c = foldCase(c);
+    return folded;
+}
+
+inline bool isWordChar(char c) {
+    unsigned char u = static_cast<unsigned char>(c);
+    return (u >= '0' && u <= '9') || (u >= 'a' && u <= 'z') || (u >= 'A' && u <= 'Z') || u >= 0x80;
+}
+
+// Calls f(token) for every run of word characters, case-folded
+template <typename F>
+void forEachToken(std::string_view text, F f) {
+    std::string token;
+    for (size_t i = 0; i <= text.size(); ++i) {
+        if (i < text.size() && isWordChar(text[i])) {
+            token += foldCase(text[i]);
+        } else if (!token.empty()) {
+            f(token);
+            token.clear();
+        }
+    }
+}
+
+// Words of `text`, case-folded and joined by single spaces
+inline std::string normalizeText(std::string_view text) {
+    std::string normalized;
+    forEachToken(text, [&normalized](const std::string& token) {
+        if (!normalized.empty()) normalized += ' ';
+        normalized += token;
+    });
+    return normalized;
+}
+
+// Edit distance between a and b counting insertions, deletions,
+// substitutions and swaps of adjacent characters (optimal string
+// alignment), or maxDistance + 1 as soon as it is certain to exceed
+// maxDistance
+inline size_t boundedEditDistance(std::string_view a, std::string_view b, size_t maxDistance) {
+    if (a.size() > b.size()) std::swap(a, b);
+    if (b.size() - a.size() > maxDistance) return maxDistance + 1;
+
+    std::vector<size_t> previous(a.size() + 1), row(a.size() + 1), current(a.size() + 1);
+    for (size_t i = 0; i <= a.size(); ++i) row[i] = i;
+    for (size_t j = 1; j <= b.size(); ++j) {
+        current[0] = j;
+        size_t best = current[0];
+        for (size_t i = 1; i <= a.size(); ++i) {
+            size_t cost = a[i - 1] != b[j - 1] ? 1 : 0;
+            current[i] = std::min(std::min(row[i], current[i - 1]) + 1, row[i - 1] + cost);
+            if (i > 1 && j > 1 && a[i - 1] == b[j - 2] && a[i - 2] == b[j - 1]) {
+                current[i] = std::min(current[i], previous[i - 2] + 1);
+            }
+            best = std::min(best, current[i]);
+        }
+        if (best > maxDistance) return maxDistance + 1;
+        previous.swap(row);
+        row.swap(current);
+    }
+    return std::min(row[a.size()], maxDistance + 1);
+}
+
+#endif
@@ -0,0 +1,67 @@
+#ifndef TIMER_QUEUE_H
+#define TIMER_QUEUE_H
+
+#include <vector>
+#include <algorithm>
+#include <utility>
+#include <ctime>
+#include <cstdint>
+
+// Min-heap of payloads keyed by the time they fall due. Only timers that
+// are due are ever touched, so draining costs O(k log n) for k due timers
+// regardless of how many are waiting. Timers due at the same time come out
+// in the order they were pushed. There is no cancel: payloads are checked
+// when they come due and ignored if they no longer apply.
+template <typename T>
+class TimerQueue {
+private:
+    struct Timer {
+        time_t when;
+        uint64_t sequence;
+        T payload;
+    };
+
+    std::vector<Timer> heap;
+    uint64_t nextSequence;
+
+    static bool later(const Timer& a, const Timer& b) {
+        return a.when != b.when ? a.when > b.when : a.sequence > b.sequence;
+    }
+
+public:
+    TimerQueue() : nextSequence(0) {}
+
+    void push(time_t when, T payload) {
+        heap.push_back(Timer{when, nextSequence++, std::move(payload)});
+        std::push_heap(heap.begin(), heap.end(), later);
+    }
+
+    // Removes the timers due at or before `now`, earliest first, and calls
+    // f(payload) for each. f may push new timers; those due by `now` are
+    // handled in the same call. Returns how many timers were handled.
+    template <typename F>
+    size_t popDue(time_t now, F f) {
+        size_t handled = 0;
+        while (!heap.empty() && heap.front().when <= now) {
+            std::pop_heap(heap.begin(), heap.end(), later);
+            T payload = std::move(heap.back().payload);
+            heap.pop_back();
+            f(payload);
+            ++handled;
+        }
+        return handled;
+    }
+
+    bool empty() const { return heap.empty(); }
+    size_t size() const { return heap.size(); }
+
+    // When the earliest timer falls due; only valid if not empty
+    time_t nextDue() const { return heap.front().when; }
+
+    void clear() {
+        heap.clear();
+        nextSequence = 0;
+    }
+};
+
+#endif
@@ -0,0 +1,106 @@
+#ifndef TRIGRAM_INDEX_H
+#define TRIGRAM_INDEX_H
+
+#include <string_view>
+#include <vector>
+#include <unordered_map>
+#include <algorithm>
+#include <cstdint>
+
+// Posting lists from letter trigrams to the ids of the words containing
+// them, used to find spelling candidates without comparing against every
+// word. Words are padded with a space on both sides, so "cat" yields
+// " ca", "cat" and "at ". One edit changes at most three trigrams, or four
+// for a swap of adjacent letters, which bounds how many a word within a
+// given edit distance must still share.
+class TrigramIndex {
+private:
+    std::unordered_map<uint32_t, std::vector<uint32_t>> postings;  // sorted word ids
+
+    static uint32_t pack(unsigned char a, unsigned char b, unsigned char c) {
+        return (static_cast<uint32_t>(a) << 16) | (static_cast<uint32_t>(b) << 8) | c;
+    }
+
+    // Distinct trigrams of the padded word
+    static std::vector<uint32_t> trigramsOf(std::string_view word) {
+        std::vector<uint32_t> trigrams;
+        size_t length = word.size() + 2;
+        auto at = [&word, length](size_t i) -> unsigned char {
+            return (i == 0 || i == length - 1) ? ' ' : static_cast<unsigned char>(word[i - 1]);
+        };
+        for (size_t i = 0; i + 2 < length; ++i) {
+            trigrams.push_back(pack(at(i), at(i + 1), at(i + 2)));
+        }
+        std::sort(trigrams.begin(), trigrams.end());
+        trigrams.erase(std::unique(trigrams.begin(), trigrams.end()), trigrams.end());
+        return trigrams;
+    }
+
+public:
+    void add(uint32_t wordId, std::string_view word) {
+        for (uint32_t trigram : trigramsOf(word)) {
+            std::vector<uint32_t>& list = postings[trigram];
+            if (list.empty() || list.back() < wordId) {
+                list.push_back(wordId);
+            } else {
+                auto it = std::lower_bound(list.begin(), list.end(), wordId);
+                if (it == list.end() || *it != wordId) list.insert(it, wordId);
+            }
+        }
+    }
+
+    void remove(uint32_t wordId, std::string_view word) {
+        for (uint32_t trigram : trigramsOf(word)) {
+            auto entry = postings.find(trigram);
+            if (entry == postings.end()) continue;
+            std::vector<uint32_t>& list = entry->second;
+            auto it = std::lower_bound(list.begin(), list.end(), wordId);
+            if (it != list.end() && *it == wordId) list.erase(it);
+            if (list.empty()) postings.erase(entry);
+        }
+    }
+
+    void clear() {
+        postings.clear();
+    }
+
+    // Ids of words sharing enough trigrams with `word` to possibly be
+    // within `maxDistance` edits of it; callers verify the distance. Words
+    // sharing no trigram at all are never proposed, even for short or
+    // repetitive words where the count bound allows it.
+    std::vector<uint32_t> candidates(std::string_view word, size_t maxDistance) const {
+        std::vector<const std::vector<uint32_t>*> lists;
+        std::vector<uint32_t> trigrams = trigramsOf(word);
+        for (uint32_t trigram : trigrams) {
+            auto entry = postings.find(trigram);
+            if (entry != postings.end()) lists.push_back(&entry->second);
+        }
+        size_t needed = trigrams.size() > 4 * maxDistance ? trigrams.size() - 4 * maxDistance : 1;
+        if (lists.size() < needed) return std::vector<uint32_t>();
+
+        // A word sharing `needed` of the trigrams appears in at least one of
+        // the (lists - needed + 1) shortest lists, so only those are merged;
+        // the rest are probed to complete the count.
+        std::sort(lists.begin(), lists.end(),
+                  [](const std::vector<uint32_t>* a, const std::vector<uint32_t>* b) { return a->size() < b->size(); });
+        size_t scanned = lists.size() - needed + 1;
+        std::vector<uint32_t> merged;
+        for (size_t i = 0; i < scanned; ++i) merged.insert(merged.end(), lists[i]->begin(), lists[i]->end());
+        std::sort(merged.begin(), merged.end());
+
+        std::vector<uint32_t> result;
+        for (size_t i = 0; i < merged.size();) {
+            size_t j = i;
+            while (j < merged.size() && merged[j] == merged[i]) ++j;
+            size_t shared = j - i;
+            for (size_t k = scanned; k < lists.size() && shared < needed; ++k) {
+                if (std::binary_search(lists[k]->begin(), lists[k]->end(), merged[i])) ++shared;
+            }
+            if (shared >= needed) result.push_back(merged[i]);
+            i = j;
+        }
+        return result;
+    }
+};
+
+#endif
@@ -1,7 +1,9 @@
-    #ifndef USER_H
+#ifndef USER_H
 #define USER_H
 
+#include "Policy.h"
 #include <string>
+#include <string_view>
 
 class User {
 protected:
@@ -9,31 +11,27 @@ protected:
     std::string name;
     std::string email;
     std::string password;
-    std::string role;
-    int maxBorrowLimit;
-    int maxBorrowPeriod;  // in days
+    Role role;
 
 public:
-    User(const std::string& name, const std::string& email, const std::string& id)
-        : name(name), email(email), userId(id), maxBorrowLimit(0), maxBorrowPeriod(0) {}
+    User(const std::string& name, const std::string& email, const std::string& id, Role role)
+        : userId(id), name(name), email(email), role(role) {}
     
     virtual ~User() = default;
 
     // Getters
-    std::string getUserId() const { return userId; }
-    std::string getName() const { return name; }
-    std::string getEmail() const { return email; }
-    std::string getPassword() const { return password; }
-    std::string getRole() const { return role; }
-    int getMaxBorrowLimit() const { return maxBorrowLimit; }
-    int getMaxBorrowPeriod() const { return maxBorrowPeriod; }
+    const std::string& getUserId() const { return userId; }
+    const std::string& getName() const { return name; }
+    const std::string& getEmail() const { return email; }
+    const std::string& getPassword() const { return password; }
+    Role getRole() const { return role; }
+    std::string_view getRoleName() const { return policyFor(role).name; }
+    const RolePolicy& getPolicy() const { return policyFor(role); }
+    int getMaxBorrowLimit() const { return getPolicy().maxBorrowLimit; }
+    int getMaxBorrowPeriod() const { return getPolicy().loanDays; }
 
     // Setters
     void setPassword(const std::string& pwd) { password = pwd; }
-    void setRole(const std::string& r) { role = r; }
-
-    // Virtual functions
-    virtual bool canBorrowBook() const { return true; }
 };
 
-#endif 
\ No newline at end of file
+#endif
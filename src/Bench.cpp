@@ -0,0 +1,572 @@
+#include "Bench.h"
+#include "Book.h"
+#include "Student.h"
+#include "Faculty.h"
+#include "Librarian.h"
+#include "EntityPools.h"
+#include "FieldParser.h"
+#include "BookStore.h"
+#include "ScanEngine.h"
+#include "TextUtil.h"
+#include "Library.h"
+#include "Clock.h"
+#include <iostream>
+#include <fstream>
+#include <filesystem>
+#include <iomanip>
+#include <sstream>
+#include <chrono>
+#include <random>
+#include <memory>
+#include <algorithm>
+#include <map>
+#include <cctype>
+#include <cstdlib>
+
+namespace {
+
+const char* const kWords[] = {
+    "history", "modern", "systems", "garden", "river", "theory", "practical", "night", "city", "introduction",
+    "algorithms", "ocean", "silent", "design", "empire", "letters", "physics", "winter", "journey", "networks"
+};
+const size_t kWordCount = sizeof(kWords) / sizeof(kWords[0]);
+
+std::string randomWords(std::mt19937& rng, int count) {
+    std::string text;
+    for (int i = 0; i < count; ++i) {
+        if (i > 0) text += ' ';
+        text += kWords[rng() % kWordCount];
+    }
+    text[0] = static_cast<char>(std::toupper(static_cast<unsigned char>(text[0])));
+    return text;
+}
+
+// books.txt as Library::saveBooks writes it; one book in ten is on loan
+std::string makeBooksFile(int rows, std::mt19937& rng) {
+    std::ostringstream out;
+    for (int id = 1; id <= rows; ++id) {
+        bool borrowed = rng() % 10 == 0;
+        out << id << "|" << randomWords(rng, 2 + rng() % 4) << " " << id << "|Author " << rng() % 50000
+            << "|Publisher " << rng() % 500 << "|" << 1950 + rng() % 75 << "|978-" << 1000000000 + rng() % 900000000
+            << "|" << (borrowed ? "Borrowed" : "Available") << "|"
+            << (borrowed ? "S" + std::to_string(1 + rng() % 9999) : "None") << "\n";
+    }
+    return out.str();
+}
+
+// users.txt as Library::saveUsers writes it
+std::string makeUsersFile(int rows, std::mt19937& rng) {
+    const char* const roles[] = {"Student", "Student", "Student", "Faculty", "Librarian"};
+    std::ostringstream out;
+    for (int i = 1; i <= rows; ++i) {
+        out << "U" << i << "|" << randomWords(rng, 2) << "|user" << i << "@example.com|secret" << rng() % 100000
+            << "|" << roles[rng() % 5] << "\n";
+    }
+    return out.str();
+}
+
+// Folds what both loaders produced into one number, to check they agree
+uint64_t bookChecksum(const Book* book) {
+    return book->getBookId() * 31ULL + book->getYear() + book->getTitle().size() + book->getIsbn().size() +
+           book->getBorrowedBy().size() * 7 + static_cast<uint64_t>(book->getStatusCode());
+}
+
+uint64_t userChecksum(const User* user) {
+    return user->getUserId().size() * 31ULL + user->getName().size() + user->getEmail().size() +
+           user->getPassword().size() + static_cast<uint64_t>(user->getRole());
+}
+
+// The books.txt loader the tokenizer replaced: a stream per line, a string
+// per field and std::stoi, with every book allocated on its own
+uint64_t parseBooksBaseline(const std::string& buffer, std::vector<Book*>& books) {
+    std::istringstream file(buffer);
+    std::string line;
+    uint64_t checksum = 0;
+
+    while (std::getline(file, line)) {
+        std::istringstream iss(line);
+        std::string id, title, author, publisher, yearStr, isbn, status, borrowedBy;
+
+        if (std::getline(iss, id, '|') &&
+            std::getline(iss, title, '|') &&
+            std::getline(iss, author, '|') &&
+            std::getline(iss, publisher, '|') &&
+            std::getline(iss, yearStr, '|') &&
+            std::getline(iss, isbn, '|') &&
+            std::getline(iss, status, '|') &&
+            std::getline(iss, borrowedBy)) {
+
+            try {
+                int bookId = std::stoi(id);
+                int year = std::stoi(yearStr);
+                BookStatus code;
+                if (!parseBookStatus(status, code)) continue;
+                Book* book = new Book(bookId, title, author, publisher, year, isbn);
+                book->setStatus(code);
+                if (!borrowedBy.empty() && borrowedBy != "None") {
+                    book->setBorrowedBy(borrowedBy);
+                }
+                books.push_back(book);
+                checksum += bookChecksum(book);
+            } catch (const std::exception&) {
+            }
+        }
+    }
+    return checksum;
+}
+
+// The loop of parseBookChunk in Library.cpp, on one thread
+uint64_t parseBooksCurrent(std::string_view buffer, EntityPools& pools, std::vector<Book*>& books) {
+    LineReader lines(buffer);
+    std::string_view line;
+    uint64_t checksum = 0;
+
+    while (lines.next(line)) {
+        if (line.empty()) continue;
+        std::string_view fields[8];
+        int bookId, year;
+        BookStatus status;
+        if (splitFields(line, fields, 8) != 8 || !parseInt(fields[0], bookId) || !parseInt(fields[4], year) ||
+            !parseBookStatus(fields[6], status)) {
+            continue;
+        }
+        Book* book = pools.books.create(bookId, std::string(fields[1]), std::string(fields[2]),
+                                        std::string(fields[3]), year, std::string(fields[5]));
+        book->setStatus(status);
+        if (!fields[7].empty() && fields[7] != "None") {
+            book->setBorrowedBy(std::string(fields[7]));
+        }
+        books.push_back(book);
+        checksum += bookChecksum(book);
+    }
+    return checksum;
+}
+
+// The users.txt loader the tokenizer replaced
+uint64_t parseUsersBaseline(const std::string& buffer, std::vector<User*>& users) {
+    std::istringstream file(buffer);
+    std::string line;
+    uint64_t checksum = 0;
+
+    while (std::getline(file, line)) {
+        std::istringstream iss(line);
+        std::string id, name, email, password, roleName;
+
+        if (std::getline(iss, id, '|') &&
+            std::getline(iss, name, '|') &&
+            std::getline(iss, email, '|') &&
+            std::getline(iss, password, '|') &&
+            std::getline(iss, roleName)) {
+
+            Role role;
+            if (!parseRole(roleName, role)) continue;
+            User* user = role == Role::Student   ? static_cast<User*>(new Student(name, email, id))
+                         : role == Role::Faculty ? static_cast<User*>(new Faculty(name, email, id))
+                                                 : static_cast<User*>(new Librarian(name, email, id));
+            user->setPassword(password);
+            users.push_back(user);
+            checksum += userChecksum(user);
+        }
+    }
+    return checksum;
+}
+
+// The loop of parseUserChunk in Library.cpp, on one thread
+uint64_t parseUsersCurrent(std::string_view buffer, EntityPools& pools, std::vector<User*>& users) {
+    LineReader lines(buffer);
+    std::string_view line;
+    uint64_t checksum = 0;
+
+    while (lines.next(line)) {
+        if (line.empty()) continue;
+        std::string_view fields[5];
+        Role role;
+        if (splitFields(line, fields, 5) != 5 || !parseRole(fields[4], role)) continue;
+        User* user = pools.createUser(role, std::string(fields[1]), std::string(fields[2]), std::string(fields[0]));
+        user->setPassword(std::string(fields[3]));
+        users.push_back(user);
+        checksum += userChecksum(user);
+    }
+    return checksum;
+}
+
+// The book storage BookStore replaced: a vector in insertion order for
+// iteration and a map by id for lookups
+struct BaselineBookStore {
+    std::vector<Book*> books;
+    std::map<int, Book*> bookMap;
+
+    void insert(Book* book) {
+        books.push_back(book);
+        bookMap[book->getBookId()] = book;
+    }
+
+    Book* get(int bookId) const {
+        auto it = bookMap.find(bookId);
+        return it != bookMap.end() ? it->second : nullptr;
+    }
+
+    Book* remove(int bookId) {
+        auto it = std::find_if(books.begin(), books.end(), [bookId](const Book* b) { return b->getBookId() == bookId; });
+        if (it == books.end()) return nullptr;
+        Book* book = *it;
+        books.erase(it);
+        bookMap.erase(bookId);
+        return book;
+    }
+
+    int nextId() const {
+        int maxId = 0;
+        for (const Book* book : books) maxId = std::max(maxId, book->getBookId());
+        return maxId + 1;
+    }
+};
+
+// The "contains" filter without ScanEngine: fold each field and look for the
+// needle in it, book by book
+std::vector<int> findContainingBaseline(const BookStore& store, const std::string& needle) {
+    std::vector<int> found;
+    std::string folded = foldCase(needle);
+    for (const Book* book : store.toVector()) {
+        if (foldCase(book->getTitle()).find(folded) != std::string::npos ||
+            foldCase(book->getAuthor()).find(folded) != std::string::npos ||
+            foldCase(book->getPublisher()).find(folded) != std::string::npos) {
+            found.push_back(book->getBookId());
+        }
+    }
+    return found;
+}
+
+// A data directory of `students` students with three loans each, one
+// borrowed book per loan
+bool writeLoansDatabase(const std::string& dir, int students) {
+    std::ofstream users(dir + "/users.txt"), books(dir + "/books.txt"), accounts(dir + "/accounts.txt");
+    int bookId = 0;
+    for (int i = 1; i <= students; ++i) {
+        std::string userId = "S" + std::to_string(i);
+        users << userId << "|Student " << i << "|" << userId << "@example.com|secret|Student\n";
+        accounts << userId << "|0|0\n";
+        for (int loan = 0; loan < 3; ++loan) {
+            ++bookId;
+            books << bookId << "|Title " << bookId << "|Author|Publisher|2000|978-" << bookId << "|Borrowed|"
+                  << userId << "\n";
+            accounts << (loan > 0 ? "|" : "") << bookId;
+        }
+        accounts << "\n";
+    }
+    return users.good() && books.good() && accounts.good();
+}
+
+const char* isaName(ScanEngine::Isa isa) {
+    switch (isa) {
+        case ScanEngine::Isa::Avx2: return "AVX2";
+        case ScanEngine::Isa::Sse2: return "SSE2";
+        case ScanEngine::Isa::Scalar: return "scalar";
+    }
+    return "?";
+}
+
+} // namespace
+
+const Bench::Suite Bench::kSuites[] = {
+    {"parse", &Bench::parse},
+    {"books", &Bench::bookStore},
+    {"scan", &Bench::scan},
+    {"fines", &Bench::fines},
+};
+
+Bench::Bench(const BenchConfig& config) : config(config) {}
+
+bool Bench::run(std::ostream& out) {
+    std::vector<std::string> selected = config.suites;
+    if (selected.empty()) {
+        for (const Suite& suite : kSuites) selected.push_back(suite.name);
+    }
+    bool ok = true;
+    for (const std::string& name : selected) {
+        const Suite* suite = std::find_if(std::begin(kSuites), std::end(kSuites),
+                                          [&name](const Suite& s) { return name == s.name; });
+        if (suite == std::end(kSuites)) {
+            std::cerr << "Error: Unknown benchmark " << name << std::endl;
+            ok = false;
+            continue;
+        }
+        rows.clear();
+        (this->*suite->run)();
+        report(out, suite->name);
+        for (const Row& row : rows) {
+            if (!row.agreed) ok = false;
+        }
+    }
+    return ok;
+}
+
+// Fastest of `repeat` runs in milliseconds; `cleanup` runs after each one,
+// outside the timing
+template <typename Run, typename Cleanup>
+double Bench::bestOf(Run run, Cleanup cleanup) const {
+    double best = 0;
+    for (int i = 0; i < config.repeat; ++i) {
+        auto start = std::chrono::steady_clock::now();
+        run();
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        cleanup();
+        if (i == 0 || ms < best) best = ms;
+    }
+    return best;
+}
+
+void Bench::report(std::ostream& out, const char* suite) const {
+    out << "\n" << suite << " (" << config.rows << " books, best of " << config.repeat << ")\n";
+    out << std::left << std::setw(36) << "Case" << std::right << std::setw(14) << "Baseline ms" << std::setw(14)
+        << "Current ms" << std::setw(12) << "Speedup" << "\n";
+    for (const Row& row : rows) {
+        out << std::left << std::setw(36) << row.name << std::right << std::fixed << std::setprecision(3)
+            << std::setw(14) << row.baselineMs << std::setw(14) << row.currentMs << std::setw(11)
+            << std::setprecision(row.baselineMs >= 10 * row.currentMs ? 0 : 2)
+            << (row.currentMs > 0 ? row.baselineMs / row.currentMs : 0.0) << "x";
+        if (!row.agreed) out << "  results differ";
+        out << "\n";
+    }
+}
+
+// Both loaders parse the same in-memory files; the current one runs on one
+// thread here, while Library::loadTextFiles also splits a file into chunks
+void Bench::parse() {
+    std::mt19937 rng(config.seed);
+    std::string booksFile = makeBooksFile(config.rows, rng);
+    std::string usersFile = makeUsersFile(std::max(1, config.rows / 10), rng);
+
+    std::vector<Book*> books;
+    std::unique_ptr<EntityPools> pools;
+    uint64_t baselineSum = 0, currentSum = 0;
+    Row row{"books.txt", 0, 0, true};
+    row.baselineMs = bestOf([&] { baselineSum = parseBooksBaseline(booksFile, books); },
+                            [&] {
+                                for (Book* book : books) delete book;
+                                books.clear();
+                            });
+    row.currentMs = bestOf(
+        [&] {
+            pools.reset(new EntityPools);
+            currentSum = parseBooksCurrent(booksFile, *pools, books);
+        },
+        [&] {
+            books.clear();
+            pools.reset();
+        });
+    row.agreed = baselineSum == currentSum;
+    rows.push_back(row);
+
+    std::vector<User*> users;
+    row = Row{"users.txt", 0, 0, true};
+    row.baselineMs = bestOf([&] { baselineSum = parseUsersBaseline(usersFile, users); },
+                            [&] {
+                                for (User* user : users) delete user;
+                                users.clear();
+                            });
+    row.currentMs = bestOf(
+        [&] {
+            pools.reset(new EntityPools);
+            currentSum = parseUsersCurrent(usersFile, *pools, users);
+        },
+        [&] {
+            users.clear();
+            pools.reset();
+        });
+    row.agreed = baselineSum == currentSum;
+    rows.push_back(row);
+}
+
+// The catalog operations that use the book storage: loading every book,
+// getBook on random ids, a walk over the catalog as the listings and sweeps
+// do, removeBook, and generateBookId for addBook
+void Bench::bookStore() {
+    std::mt19937 rng(config.seed);
+    EntityPools pools;
+    std::vector<Book*> created;
+    created.reserve(config.rows);
+    for (int id = 1; id <= config.rows; ++id) {
+        created.push_back(pools.books.create(id, randomWords(rng, 3), "Author", "Publisher", 2000, "978"));
+    }
+    std::vector<int> lookups(config.rows);
+    for (int& id : lookups) id = 1 + static_cast<int>(rng() % config.rows);
+    std::vector<int> removals(std::max(1, config.rows / 1000));
+    for (int& id : removals) id = 1 + static_cast<int>(rng() % config.rows);
+    std::sort(removals.begin(), removals.end());
+    removals.erase(std::unique(removals.begin(), removals.end()), removals.end());
+    std::shuffle(removals.begin(), removals.end(), rng);
+
+    std::unique_ptr<BaselineBookStore> baseline;
+    std::unique_ptr<BookStore> current;
+    auto fillBaseline = [&] {
+        baseline.reset(new BaselineBookStore);
+        for (Book* book : created) baseline->insert(book);
+    };
+    auto fillCurrent = [&] {
+        current.reset(new BookStore);
+        for (Book* book : created) current->insert(book);
+    };
+    auto nothing = [] {};
+    uint64_t baselineSum = 0, currentSum = 0;
+
+    Row row{"load all books", 0, 0, true};
+    row.baselineMs = bestOf(fillBaseline, nothing);
+    row.currentMs = bestOf(fillCurrent, nothing);
+    row.agreed = baseline->books.size() == current->size();
+    rows.push_back(row);
+
+    row = Row{"getBook, random ids", 0, 0, true};
+    row.baselineMs = bestOf([&] {
+        baselineSum = 0;
+        for (int id : lookups) baselineSum += baseline->get(id)->getBookId();
+    }, nothing);
+    row.currentMs = bestOf([&] {
+        currentSum = 0;
+        for (int id : lookups) currentSum += current->get(id)->getBookId();
+    }, nothing);
+    row.agreed = baselineSum == currentSum;
+    rows.push_back(row);
+
+    row = Row{"walk the catalog", 0, 0, true};
+    row.baselineMs = bestOf([&] {
+        baselineSum = 0;
+        for (const Book* book : baseline->books) baselineSum += book->getTitle().size();
+    }, nothing);
+    row.currentMs = bestOf([&] {
+        currentSum = 0;
+        for (const Book* book : *current) currentSum += book->getTitle().size();
+    }, nothing);
+    row.agreed = baselineSum == currentSum;
+    rows.push_back(row);
+
+    row = Row{"removeBook x" + std::to_string(removals.size()), 0, 0, true};
+    row.baselineMs = bestOf([&] {
+        baselineSum = 0;
+        for (int id : removals) baselineSum += baseline->remove(id) != nullptr;
+    }, fillBaseline);
+    row.currentMs = bestOf([&] {
+        currentSum = 0;
+        for (int id : removals) currentSum += current->remove(id) != nullptr;
+    }, fillCurrent);
+    row.agreed = baselineSum == currentSum;
+    rows.push_back(row);
+
+    row = Row{"generateBookId x100", 0, 0, true};
+    row.baselineMs = bestOf([&] {
+        baselineSum = 0;
+        for (int i = 0; i < 100; ++i) baselineSum += baseline->nextId();
+    }, nothing);
+    row.currentMs = bestOf([&] {
+        currentSum = 0;
+        for (int i = 0; i < 100; ++i) currentSum += current->nextId();
+    }, nothing);
+    row.agreed = baselineSum == currentSum;
+    rows.push_back(row);
+}
+
+// Substring filters with few, some and very many matches, on every kernel
+// the CPU supports
+void Bench::scan() {
+    std::mt19937 rng(config.seed);
+    EntityPools pools;
+    BookStore store;
+    ScanEngine engine;
+    for (int id = 1; id <= config.rows; ++id) {
+        Book* book = pools.books.create(id, randomWords(rng, 2 + rng() % 4) + " " + std::to_string(id),
+                                        "Author " + std::to_string(rng() % 50000),
+                                        "Publisher " + std::to_string(rng() % 500), 2000, "978");
+        store.insert(book);
+        engine.add(*book);
+    }
+    const std::string needles[] = {std::to_string(config.rows / 3), "Author 4999", "ory"};
+    std::vector<ScanEngine::Isa> kernels;
+    for (ScanEngine::Isa isa : {ScanEngine::Isa::Avx2, ScanEngine::Isa::Sse2, ScanEngine::Isa::Scalar}) {
+        engine.setIsa(isa);
+        if (engine.getIsa() == isa) kernels.push_back(isa);
+    }
+
+    auto nothing = [] {};
+    for (const std::string& needle : needles) {
+        std::vector<int> expected, found;
+        double baselineMs = bestOf([&] { expected = findContainingBaseline(store, needle); }, nothing);
+        std::string name = "\"" + needle + "\" (" + std::to_string(expected.size()) + " hits) ";
+        for (ScanEngine::Isa isa : kernels) {
+            engine.setIsa(isa);
+            Row row{name + isaName(isa), baselineMs, 0, true};
+            row.currentMs = bestOf([&] { found = engine.find(needle); }, nothing);
+            row.agreed = found == expected;
+            rows.push_back(row);
+        }
+    }
+}
+
+// A fine sweep over every active loan: calculateFines, which pops each loan
+// whose fine grew from the due-time queue, against calculateFinesBatch over
+// the loan table. Each library loads the same loans on its own VirtualClock;
+// both clocks move a day before each timed sweep, so every loan's fine grows,
+// and then stay put for a sweep with nothing new to charge.
+void Bench::fines() {
+    int students = std::max(1, config.rows / 3);
+    std::string loans = std::to_string(students * 3) + " loans";
+    std::filesystem::path scratch = std::filesystem::temp_directory_path() / "lms-bench-XXXXXX";
+    std::string dir = scratch.string();
+    if (!mkdtemp(&dir[0]) || !writeLoansDatabase(dir, students)) {
+        std::cerr << "Error: Cannot create the fines database in " << dir << std::endl;
+        rows.push_back(Row{loans, 0, 0, false});
+        return;
+    }
+    std::filesystem::create_directory(dir + "/batch");
+    for (const char* file : {"users.txt", "books.txt", "accounts.txt"}) {
+        std::filesystem::copy_file(dir + "/" + file, dir + "/batch/" + file);
+    }
+
+    // The libraries report loading and saving on the console
+    std::stringbuf console;
+    std::streambuf* saved = std::cout.rdbuf(&console);
+    {
+        const time_t start = 1000000000;
+        VirtualClock baselineClock(start), currentClock(start);
+        Library baseline(dir, baselineClock), current(dir + "/batch", currentClock);
+        // Keep the journal out of the timings; the changes are committed once,
+        // when the libraries are destroyed
+        baseline.setCommitPolicy(CommitPolicy::EveryNOperations, SIZE_MAX);
+        current.setCommitPolicy(CommitPolicy::EveryNOperations, SIZE_MAX);
+        // Restored loans are due in 15 days; go to the first day with a fine
+        const RolePolicy& student = policyFor(Role::Student);
+        baselineClock.advance(baselineClock.days(student.loanDays + student.fineGraceDays + 1));
+        currentClock.advance(currentClock.days(student.loanDays + student.fineGraceDays + 1));
+
+        auto nothing = [] {};
+        auto totalsAgree = [&] {
+            for (int i = 1; i <= students; ++i) {
+                std::string userId = "S" + std::to_string(i);
+                const Account* a = baseline.getAccount(userId);
+                const Account* b = current.getAccount(userId);
+                if (!a || !b || a->getTotalFine() != b->getTotalFine()) return false;
+            }
+            return true;
+        };
+
+        Row row{loans + ", a day more overdue", 0, 0, true};
+        row.baselineMs = bestOf([&] { baseline.calculateFines(); },
+                                [&] { baselineClock.advance(baselineClock.days(1)); });
+        row.currentMs = bestOf([&] { current.calculateFinesBatch(); },
+                               [&] { currentClock.advance(currentClock.days(1)); });
+        // Undo the last advance, which no sweep saw
+        baselineClock.advance(-baselineClock.days(1));
+        currentClock.advance(-currentClock.days(1));
+        row.agreed = totalsAgree();
+        rows.push_back(row);
+
+        row = Row{loans + ", nothing new to charge", 0, 0, true};
+        row.baselineMs = bestOf([&] { baseline.calculateFines(); }, nothing);
+        row.currentMs = bestOf([&] { current.calculateFinesBatch(); }, nothing);
+        row.agreed = totalsAgree();
+        rows.push_back(row);
+    }
+    std::cout.rdbuf(saved);
+
+    std::error_code error;
+    std::filesystem::remove_all(dir, error);
+}
@@ -0,0 +1,128 @@
+#include "Journal.h"
+#include <fstream>
+#include <iostream>
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+Journal::Journal(const std::string& path, size_t groupSize)
+    : path(path), fd(-1), groupSize(groupSize ? groupSize : 1), pending(0), size(0) {
+    fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_APPEND, 0644);
+    if (fd < 0) {
+        std::cerr << "Error: Cannot open journal " << path << std::endl;
+        return;
+    }
+    dropTornRecord();
+}
+
+// A crash can leave the last record without its newline. Replay skips it,
+// but the next record would be appended to the same line and be rejected
+// with it, so the fragment is cut off before anything is written.
+void Journal::dropTornRecord() {
+    off_t end = ::lseek(fd, 0, SEEK_END);
+    off_t keep = end;
+    size = end;
+    char block[4096];
+    while (keep > 0) {
+        off_t start = keep > static_cast<off_t>(sizeof(block)) ? keep - static_cast<off_t>(sizeof(block)) : 0;
+        size_t length = static_cast<size_t>(keep - start);
+        if (::pread(fd, block, length, start) != static_cast<ssize_t>(length)) return;
+        size_t i = length;
+        while (i > 0 && block[i - 1] != '\n') --i;
+        if (i > 0) {
+            keep = start + static_cast<off_t>(i);
+            break;
+        }
+        keep = start;
+    }
+    if (keep == end) return;
+    if (::ftruncate(fd, keep) != 0 || ::fsync(fd) != 0) {
+        std::cerr << "Error: Failed to drop the torn record at the end of " << path << std::endl;
+        return;
+    }
+    size = keep;
+}
+
+Journal::~Journal() {
+    if (fd >= 0) {
+        sync();
+        ::close(fd);
+    }
+}
+
+bool Journal::append(char type, const std::string& payload) {
+    if (fd < 0) return false;
+
+    std::string line;
+    line.reserve(payload.size() + 3);
+    line += type;
+    line += '|';
+    line += payload;
+    line += '\n';
+
+    const char* data = line.data();
+    size_t left = line.size();
+    while (left > 0) {
+        ssize_t n = ::write(fd, data, left);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) {
+            // Cut off the part that was written, so the next record starts
+            // on a line of its own
+            std::cerr << "Error: Failed to write journal record" << std::endl;
+            if (::ftruncate(fd, size) != 0) {
+                std::cerr << "Error: Failed to truncate journal " << path << std::endl;
+            }
+            return false;
+        }
+        data += n;
+        left -= static_cast<size_t>(n);
+    }
+    size += static_cast<off_t>(line.size());
+
+    // Group commit: one fsync covers the last `groupSize` records
+    if (++pending >= groupSize) {
+        return sync();
+    }
+    return true;
+}
+
+bool Journal::sync() {
+    if (fd < 0) return false;
+    if (pending == 0) return true;
+    if (::fsync(fd) != 0) {
+        std::cerr << "Error: Failed to sync journal " << path << std::endl;
+        return false;
+    }
+    pending = 0;
+    return true;
+}
+
+std::vector<JournalRecord> Journal::readAll() const {
+    std::vector<JournalRecord> records;
+    std::ifstream file(path);
+    std::string line;
+
+    while (std::getline(file, line)) {
+        // A record without its trailing newline was torn by a crash
+        if (file.eof()) break;
+        if (line.size() < 2 || line[1] != '|') continue;
+        records.push_back(JournalRecord{line[0], line.substr(2)});
+    }
+    return records;
+}
+
+void Journal::reset() {
+    if (fd < 0) return;
+    if (::ftruncate(fd, 0) != 0) {
+        std::cerr << "Error: Failed to truncate journal " << path << std::endl;
+    }
+    ::fsync(fd);
+    pending = 0;
+    size = 0;
+}
+
+bool Journal::empty() const {
+    struct stat st;
+    return ::stat(path.c_str(), &st) != 0 || st.st_size == 0;
+}
@@ -2,13 +2,19 @@
 #include "Student.h"
 #include "Faculty.h"
 #include "Librarian.h"
+#include "Snapshot.h"
+#include "FieldParser.h"
+#include "ThreadPool.h"
+#include "TextUtil.h"
+#include "DurableFile.h"
 #include <fstream>
 #include <sstream>
 #include <ctime>
 #include <algorithm>
+#include <map>
+#include <unordered_set>
 #include <iomanip>
 #include <iostream>
-#include <sys/stat.h>
 #include <unistd.h> // for getcwd
 #include <chrono>   // for modern time handling
 #include <filesystem>
@@ -22,7 +28,393 @@ std::string getCurrentTimestamp() {
     return ss.str();
 }
 
-Library::Library(const std::string& dir) : dataDir(dir) {
+namespace {
+
+void reportMalformedLine(const char* file, size_t lineNumber, const char* reason) {
+    std::cerr << "Error: " << file << " line " << lineNumber << ": " << reason << std::endl;
+}
+
+// Text form of the role, as stored in users.txt
+User* makeUser(EntityPools& pools, std::string_view roleName, const std::string& name,
+               const std::string& email, const std::string& id) {
+    Role role;
+    return parseRole(roleName, role) ? pools.createUser(role, name, email, id) : nullptr;
+}
+
+// Same format as ctime(), without the trailing newline
+std::string formatDate(time_t when) {
+    std::string text(ctime(&when));
+    return text.substr(0, text.length() - 1);
+}
+
+// Size of the heap block glibc malloc hands out for a request of n bytes
+size_t mallocBlock(size_t n) {
+    size_t block = (n + 8 + 15) & ~static_cast<size_t>(15);
+    return block < 32 ? 32 : block;
+}
+
+// Heap bytes behind a string; short strings live inline (SSO)
+size_t stringHeap(const std::string& text) {
+    return text.capacity() > 15 ? mallocBlock(text.capacity() + 1) : 0;
+}
+
+// One row of the memory report
+struct MemoryUsage {
+    size_t live = 0;
+    size_t poolBytes = 0;     // chunks reserved by the pool
+    size_t objectBytes = 0;   // what individual new would have used for the objects
+    size_t heapBytes = 0;     // strings and containers owned by the objects
+    size_t legacyBytes = 0;   // extra heap of the pre-pool layout (string dates)
+};
+
+void printMemoryRow(std::ostream& out, const char* name, const MemoryUsage& usage) {
+    size_t before = usage.objectBytes + usage.heapBytes + usage.legacyBytes;
+    size_t after = usage.poolBytes + usage.heapBytes;
+    out << std::left << std::setw(10) << name << std::right
+        << std::setw(10) << usage.live
+        << std::setw(14) << usage.poolBytes
+        << std::setw(14) << usage.heapBytes
+        << std::setw(14) << before
+        << std::setw(14) << after << '\n';
+}
+
+// Objects parsed from one chunk of a data file, with errors keyed by line
+// number relative to the start of the chunk
+template <typename T>
+struct ParsedChunk {
+    std::vector<T*> items;
+    std::vector<std::pair<size_t, const char*>> errors;
+    size_t lineCount = 0;
+};
+
+const size_t kMinChunkSize = 1 << 20;
+
+// Splits a buffer into roughly equal pieces that end on line boundaries
+std::vector<std::string_view> splitAtLines(std::string_view buffer, size_t maxChunks) {
+    std::vector<std::string_view> chunks;
+    size_t chunkCount = std::max<size_t>(1, std::min(maxChunks, buffer.size() / kMinChunkSize));
+    size_t target = buffer.size() / chunkCount;
+    size_t start = 0;
+
+    while (start < buffer.size()) {
+        size_t end = buffer.size();
+        if (chunks.size() + 1 < chunkCount && start + target < buffer.size()) {
+            size_t newline = buffer.find('\n', start + target);
+            end = newline == std::string_view::npos ? buffer.size() : newline + 1;
+        }
+        chunks.push_back(buffer.substr(start, end - start));
+        start = end;
+    }
+    return chunks;
+}
+
+template <typename T, typename ParseFn>
+std::vector<std::future<ParsedChunk<T>>> parseInChunks(ThreadPool& pool, std::string_view buffer, ParseFn parse) {
+    std::vector<std::future<ParsedChunk<T>>> futures;
+    for (std::string_view chunk : splitAtLines(buffer, pool.size())) {
+        futures.push_back(pool.submit([chunk, parse] { return parse(chunk); }));
+    }
+    return futures;
+}
+
+template <typename T, typename Sink>
+void mergeChunks(std::vector<std::future<ParsedChunk<T>>>& futures, const char* file, Sink sink) {
+    size_t lineOffset = 0;
+    for (auto& future : futures) {
+        ParsedChunk<T> chunk = future.get();
+        for (const auto& error : chunk.errors) {
+            reportMalformedLine(file, lineOffset + error.first, error.second);
+        }
+        for (T* item : chunk.items) {
+            sink(item);
+        }
+        lineOffset += chunk.lineCount;
+    }
+}
+
+// Restores a loan read back from disk; borrow dates are not persisted
+void addRestoredLoan(Account* account, int bookId, const Clock& clock) {
+    time_t now = clock.now();
+    account->addBorrowedBook(bookId, now, now + clock.days(15));
+}
+
+std::string formatUser(const User* user) {
+    std::ostringstream out;
+    out << user->getUserId() << "|"
+        << user->getName() << "|"
+        << user->getEmail() << "|"
+        << user->getPassword() << "|"
+        << user->getRoleName();
+    return out.str();
+}
+
+std::string formatBook(const Book* book) {
+    std::ostringstream out;
+    out << book->getBookId() << "|"
+        << book->getTitle() << "|"
+        << book->getAuthor() << "|"
+        << book->getPublisher() << "|"
+        << book->getYear() << "|"
+        << book->getIsbn() << "|"
+        << book->getStatus() << "|"
+        << (book->getBorrowedBy().empty() ? "None" : book->getBorrowedBy());
+    return out.str();
+}
+
+// Journal form of an account: header fields followed by comma-separated loans
+std::string formatAccount(const Account* account) {
+    std::ostringstream out;
+    out << account->getUserId() << "|"
+        << account->getTotalFine() << "|"
+        << (account->isFinePaid() ? "1" : "0") << "|";
+    bool first = true;
+    for (int bookId : account->getCurrentlyBorrowedBooks()) {
+        if (!first) out << ",";
+        out << bookId;
+        first = false;
+    }
+    return out.str();
+}
+
+ParsedChunk<User> parseUserChunk(EntityPools& pools, std::string_view chunk) {
+    ParsedChunk<User> result;
+    LineReader lines(chunk);
+    std::string_view line;
+
+    while (lines.next(line)) {
+        if (line.empty()) continue;
+
+        std::string_view fields[5];
+        if (splitFields(line, fields, 5) != 5) {
+            result.errors.emplace_back(lines.getLineNumber(), "expected 5 fields");
+            continue;
+        }
+
+        User* user = makeUser(pools, fields[4], std::string(fields[1]),
+                              std::string(fields[2]), std::string(fields[0]));
+        if (!user) {
+            result.errors.emplace_back(lines.getLineNumber(), "unknown role");
+            continue;
+        }
+        user->setPassword(std::string(fields[3]));
+        result.items.push_back(user);
+    }
+    result.lineCount = lines.getLineNumber();
+    return result;
+}
+
+ParsedChunk<Book> parseBookChunk(EntityPools& pools, std::string_view chunk) {
+    ParsedChunk<Book> result;
+    LineReader lines(chunk);
+    std::string_view line;
+
+    while (lines.next(line)) {
+        if (line.empty()) continue;
+
+        std::string_view fields[8];
+        int bookId, year;
+        BookStatus status;
+        if (splitFields(line, fields, 8) != 8) {
+            result.errors.emplace_back(lines.getLineNumber(), "expected 8 fields");
+            continue;
+        }
+        if (!parseInt(fields[0], bookId) || !parseInt(fields[4], year)) {
+            result.errors.emplace_back(lines.getLineNumber(), "invalid book id or year");
+            continue;
+        }
+        if (!parseBookStatus(fields[6], status)) {
+            result.errors.emplace_back(lines.getLineNumber(), "unknown book status");
+            continue;
+        }
+
+        Book* book = pools.books.create(bookId, std::string(fields[1]), std::string(fields[2]),
+                              std::string(fields[3]), year, std::string(fields[5]));
+        book->setStatus(status);
+        if (!fields[7].empty() && fields[7] != "None") {
+            book->setBorrowedBy(std::string(fields[7]));
+        }
+        result.items.push_back(book);
+    }
+    result.lineCount = lines.getLineNumber();
+    return result;
+}
+
+ParsedChunk<Account> parseAccountChunk(EntityPools& pools, std::string_view chunk, const Clock& clock) {
+    ParsedChunk<Account> result;
+    LineReader lines(chunk);
+    std::string_view line;
+
+    while (lines.next(line)) {
+        if (line.empty()) continue;
+
+        std::string_view fields[3];
+        double totalFine;
+        if (splitFields(line, fields, 3) != 3 || !parseDouble(fields[1], totalFine)) {
+            result.errors.emplace_back(lines.getLineNumber(), "expected userId|fine|paid");
+            continue;
+        }
+
+        Account* account = pools.accounts.create(std::string(fields[0]));
+        account->updateFine(totalFine);
+        account->setFinePaid(fields[2] == "1");
+
+        // Read borrowed books on next line
+        std::string_view loans;
+        if (lines.next(loans)) {
+            FieldReader reader(loans);
+            std::string_view field;
+            while (reader.next(field)) {
+                int bookId;
+                if (field.empty()) continue;
+                if (parseInt(field, bookId)) {
+                    addRestoredLoan(account, bookId, clock);
+                } else {
+                    result.errors.emplace_back(lines.getLineNumber(), "invalid borrowed book id");
+                }
+            }
+        }
+        result.items.push_back(account);
+    }
+    result.lineCount = lines.getLineNumber();
+    return result;
+}
+
+// Journal record types; upper case upserts an entity, lower case removes it
+const char kUserRecord = 'U';
+const char kUserRemoved = 'u';
+const char kBookRecord = 'B';
+const char kBookRemoved = 'b';
+const char kAccountRecord = 'A';
+const char kAccountRemoved = 'a';
+
+const char* const kTextFileNames[snapshot::kTextFileCount] = {"users.txt", "books.txt", "accounts.txt"};
+
+// Fine owed on a loan due at `dueDate`, as of `now`: the role's daily rate
+// for every whole day overdue beyond its grace period
+double fineAt(const RolePolicy& policy, time_t dueDate, time_t now, time_t secondsPerDay) {
+    if (now <= dueDate) return 0.0;
+    long long daysOverdue = (now - dueDate) / secondsPerDay;
+    if (daysOverdue <= policy.fineGraceDays) return 0.0;
+    return (daysOverdue - policy.fineGraceDays) * policy.finePerDay;
+}
+
+// First moment after `now` at which fineAt grows
+time_t nextFineIncrease(const RolePolicy& policy, time_t dueDate, time_t now, time_t secondsPerDay) {
+    time_t firstFine = dueDate + (policy.fineGraceDays + 1) * secondsPerDay;
+    if (now < firstFine) return firstFine;
+    return now + secondsPerDay - (now - dueDate) % secondsPerDay;
+}
+
+// Drops all but the last mark of each entity; a batch marks the same
+// account once per request
+template <typename Marks>
+void keepLastMarks(Marks& marks) {
+    if (marks.size() < 2) return;
+    if (marks.size() == 2) {
+        if (marks[0].first == marks[1].first) marks.erase(marks.begin());
+        return;
+    }
+    std::unordered_set<typename Marks::value_type::first_type> seen;
+    Marks kept;
+    for (auto it = marks.rbegin(); it != marks.rend(); ++it) {
+        if (seen.insert(it->first).second) kept.push_back(*it);
+    }
+    std::reverse(kept.begin(), kept.end());
+    marks.swap(kept);
+}
+
+// A patron as the requests before it in a batch leave them
+struct PendingPatron {
+    Patron patron;
+    size_t borrowed;  // books on loan
+};
+
+// A book as the requests before it in a batch leave it
+struct PendingBook {
+    Book* book;
+    BookStatus status;
+    std::string borrowedBy;
+    std::vector<std::string> queue;  // reservations, head first
+
+    bool hasReservation(const std::string& userId) const {
+        return std::find(queue.begin(), queue.end(), userId) != queue.end();
+    }
+};
+
+// Checks a request with the rules of borrowBook, returnBook and reserveBook
+// and, if it may go ahead, applies it to the pending state. Returns why it
+// was refused, or an empty string.
+std::string admit(const CirculationRequest& request, PendingPatron& patron, PendingBook& book) {
+    const std::string& userId = request.userId;
+    switch (request.action) {
+    case CirculationRequest::Action::Borrow: {
+        if (!patron.patron.user || !patron.patron.account) return "No such user.";
+        if (!book.book) return "No such book.";
+        if (book.status != BookStatus::Available) return "Book is not available.";
+        if (!book.queue.empty() && book.queue.front() != userId) return "This book is reserved for another user.";
+        const RolePolicy& policy = patron.patron.user->getPolicy();
+        if (!policy.canBorrow) return "This user cannot borrow books.";
+        if (policy.mustReturnBeforeBorrow && patron.borrowed > 0) {
+            return "Return the borrowed books before borrowing another.";
+        }
+        if (patron.borrowed >= static_cast<size_t>(policy.maxBorrowLimit)) return "Borrowing limit reached.";
+        book.status = BookStatus::Borrowed;
+        book.borrowedBy = userId;
+        book.queue.erase(std::remove(book.queue.begin(), book.queue.end(), userId), book.queue.end());
+        ++patron.borrowed;
+        return "";
+    }
+    case CirculationRequest::Action::Return:
+        if (!patron.patron.account) return "No such user.";
+        if (!book.book) return "No such book.";
+        if (book.borrowedBy != userId) return "This book is not on loan to this user.";
+        book.status = BookStatus::Available;
+        book.borrowedBy.clear();
+        --patron.borrowed;
+        return "";
+    case CirculationRequest::Action::Reserve:
+        if (!patron.patron.user) return "No such user.";
+        if (!book.book) return "No such book.";
+        if (book.status == BookStatus::Available) return "Book is available for borrowing. No need to reserve.";
+        if (book.borrowedBy == userId || book.hasReservation(userId)) {
+            return "You have already borrowed or reserved this book.";
+        }
+        book.queue.push_back(userId);
+        return "";
+    }
+    return "Unknown request.";
+}
+
+// Replaces or appends `entity` at the position `key` has in `entities`
+template <typename T, typename Destroy>
+void replaceAt(std::vector<T*>& entities, std::unordered_map<std::string, size_t>& positions,
+               const std::string& key, T* entity, Destroy destroy) {
+    auto it = positions.find(key);
+    if (it != positions.end()) {
+        destroy(entities[it->second]);
+        entities[it->second] = entity;
+    } else {
+        positions.emplace(key, entities.size());
+        entities.push_back(entity);
+    }
+}
+
+// Removes the entity at the position of `key`, leaving a gap
+template <typename T, typename Destroy>
+void removeAt(std::vector<T*>& entities, std::unordered_map<std::string, size_t>& positions,
+              const std::string& key, Destroy destroy) {
+    auto it = positions.find(key);
+    if (it == positions.end()) return;
+    destroy(entities[it->second]);
+    entities[it->second] = nullptr;
+    positions.erase(it);
+}
+
+} // namespace
+
+Library::Library(const std::string& dir, const Clock& clock)
+    : dataDir(dir), clock(clock), checkpointGeneration(0), commitPolicy(CommitPolicy::Immediate), commitParameter(0),
+      pendingOperations(0), stopFlusher(false) {
     // Convert relative path to absolute path if needed
     if (dataDir == "data") {
         char cwd[1024];
@@ -34,11 +426,15 @@ Library::Library(const std::string& dir) : dataDir(dir) {
     // Create data directory if it doesn't exist
     std::string mkdirCmd = "mkdir -p " + dataDir;
     system(mkdirCmd.c_str());
+
+    journal.reset(new Journal(dataDir + "/journal.log"));
     
     // Check if any of the data files exist
     bool hasExistingData = fileExistsAndHasContent(dataDir + "/users.txt") ||
                           fileExistsAndHasContent(dataDir + "/books.txt") ||
-                          fileExistsAndHasContent(dataDir + "/accounts.txt");
+                          fileExistsAndHasContent(dataDir + "/accounts.txt") ||
+                          fileExistsAndHasContent(dataDir + "/library.snap") ||
+                          !journal->empty();
 
     if (hasExistingData) {
         loadData();  // Load data only once
@@ -52,17 +448,20 @@ Library::Library(const std::string& dir) : dataDir(dir) {
 }
 
 Library::~Library() {
-    saveData();
-    // Clean up memory
-    for (auto& user : users) delete user;
-    for (auto& book : books) delete book;
-    for (auto& account : accounts) delete account;
+    stopFlusherThread();
+    // Make everything durable in the journal before the data files are rewritten
+    flush();
+    checkpoint();
+    // Users, books and accounts are released in bulk with their pools
 }
 
 void Library::loadData() {
-    loadUsers();
-    loadBooks();
-    loadAccounts();
+    if (!loadSnapshot()) {
+        loadTextFiles();
+    }
+    replayJournal();
+    rebuildBookIndexes();
+    rebuildLoanIndexes();
     
     if (users.empty()) {
         std::cout << "No existing users found. Initializing with default data...\n";
@@ -70,157 +469,155 @@ void Library::loadData() {
     }
 }
 
-void Library::loadUsers() {
-    std::ifstream file(dataDir + "/users.txt");
-    std::string line;
-    
-    while (std::getline(file, line)) {
-        std::istringstream iss(line);
-        std::string id, name, email, password, role;
-        
-        if (std::getline(iss, id, '|') && 
-            std::getline(iss, name, '|') && 
-            std::getline(iss, email, '|') && 
-            std::getline(iss, password, '|') && 
-            std::getline(iss, role)) {
-            
-            User* user = nullptr;
-            if (role == "Student") {
-                user = new Student(name, email, id);
-            } else if (role == "Faculty") {
-                user = new Faculty(name, email, id);
-            } else if (role == "Librarian") {
-                user = new Librarian(name, email, id);
-            }
-            
-            if (user) {
-                user->setPassword(password);
-                users.push_back(user);
-                userMap[id] = user;
-            }
+void Library::loadTextFiles() {
+    ThreadPool pool;
+
+    // The three files are independent: read them concurrently...
+    auto userRead = pool.submit([this] { return readWholeFile(dataDir + "/users.txt"); });
+    auto bookRead = pool.submit([this] { return readWholeFile(dataDir + "/books.txt"); });
+    auto accountRead = pool.submit([this] { return readWholeFile(dataDir + "/accounts.txt"); });
+    std::string userBuffer = userRead.get();
+    std::string bookBuffer = bookRead.get();
+    std::string accountBuffer = accountRead.get();
+
+    // ...then parse them in line-aligned chunks. Account records span two
+    // lines, so that file is parsed as a single task.
+    auto userChunks = parseInChunks<User>(pool, userBuffer,
+        [this](std::string_view chunk) { return parseUserChunk(pools, chunk); });
+    auto bookChunks = parseInChunks<Book>(pool, bookBuffer,
+        [this](std::string_view chunk) { return parseBookChunk(pools, chunk); });
+    std::vector<std::future<ParsedChunk<Account>>> accountChunks;
+    accountChunks.push_back(pool.submit([this, &accountBuffer] { return parseAccountChunk(pools, accountBuffer, clock); }));
+
+    // Merge in file order so the result matches a sequential load
+    mergeChunks<User>(userChunks, "users.txt", [this](User* user) {
+        users.push_back(user);
+        patrons.setUser(user->getUserId(), user);
+    });
+    mergeChunks<Book>(bookChunks, "books.txt", [this](Book* book) {
+        if (!books.insert(book)) {
+            std::cerr << "Error: books.txt: duplicate or invalid book id " << book->getBookId() << std::endl;
+            pools.books.destroy(book);
         }
-    }
+    });
+    mergeChunks<Account>(accountChunks, "accounts.txt", [this](Account* account) {
+        accounts.push_back(account);
+        patrons.setAccount(account->getUserId(), account);
+    });
 }
 
-void Library::loadBooks() {
-    std::ifstream file(dataDir + "/books.txt");
-    std::string line;
-    
-    while (std::getline(file, line)) {
-        std::istringstream iss(line);
-        std::string id, title, author, publisher, yearStr, isbn, status, borrowedBy;
-        
-        if (std::getline(iss, id, '|') && 
-            std::getline(iss, title, '|') && 
-            std::getline(iss, author, '|') && 
-            std::getline(iss, publisher, '|') && 
-            std::getline(iss, yearStr, '|') && 
-            std::getline(iss, isbn, '|') && 
-            std::getline(iss, status, '|') && 
-            std::getline(iss, borrowedBy)) {
-            
-            try {
-                int bookId = std::stoi(id);
-                int year = std::stoi(yearStr);
-                Book* book = new Book(bookId, title, author, publisher, year, isbn);
-                book->setStatus(status);
-                if (!borrowedBy.empty() && borrowedBy != "None") {
-                    book->setBorrowedBy(borrowedBy);
-                }
-                books.push_back(book);
-                bookMap[bookId] = book;
-            } catch (const std::exception& e) {
-                std::cerr << "Error loading book: " << e.what() << std::endl;
-            }
+// True if the text files are still the ones written with the snapshot. A
+// missing file does not count as a change.
+bool Library::snapshotMatchesTextFiles(const snapshot::Reader& reader) const {
+    for (int file = 0; file < snapshot::kTextFileCount; ++file) {
+        FileFingerprint current;
+        if (fingerprintFile(dataDir + "/" + kTextFileNames[file], current) &&
+            current != reader.checkpoint().textFiles[file]) {
+            return false;
         }
     }
+    return true;
 }
 
-void Library::loadAccounts() {
-    std::ifstream file(dataDir + "/accounts.txt");
-    std::string line;
-    
-    while (std::getline(file, line)) {
-        std::istringstream iss(line);
-        std::string userId, totalFineStr, finePaidStr;
-        
-        if (std::getline(iss, userId, '|') && 
-            std::getline(iss, totalFineStr, '|') && 
-            std::getline(iss, finePaidStr)) {
-            
-            try {
-                Account* account = new Account(userId);
-                account->updateFine(std::stod(totalFineStr));
-                account->setFinePaid(finePaidStr == "1");
-                
-                // Read borrowed books on next line
-                if (std::getline(file, line)) {
-                    std::istringstream bookIss(line);
-                    std::string bookId;
-                    while (std::getline(bookIss, bookId, '|')) {
-                        if (!bookId.empty()) {
-                            // Get current time for borrow date
-                            time_t now = time(0);
-                            char* dt = ctime(&now);
-                            std::string borrowDate(dt);
-                            borrowDate = borrowDate.substr(0, borrowDate.length() - 1);
-
-                            // Calculate due date
-                            now += 15 * 10; // 15 days (10 seconds = 1 day for testing)
-                            dt = ctime(&now);
-                            std::string dueDate(dt);
-                            dueDate = dueDate.substr(0, dueDate.length() - 1);
-
-                            account->addBorrowedBook(std::stoi(bookId), borrowDate, dueDate);
-                        }
-                    }
-                }
-                
-                accounts.push_back(account);
-                accountMap[userId] = account;
-            } catch (const std::exception& e) {
-                std::cerr << "Error loading account: " << e.what() << std::endl;
-            }
+bool Library::loadSnapshot() {
+    std::string path = dataDir + "/library.snap";
+    if (!fileExistsAndHasContent(path)) return false;
+    snapshot::Reader reader;
+    if (!reader.open(path)) {
+        std::cerr << "Error: Snapshot is missing or corrupt, loading text files instead." << std::endl;
+        return false;
+    }
+    // Later checkpoints continue the numbering even if the text files win
+    checkpointGeneration = reader.checkpoint().generation;
+    // The text files are authoritative when they are not the ones written
+    // in the snapshot's checkpoint: edited by hand, or a checkpoint stopped
+    // before the snapshot was replaced
+    if (!snapshotMatchesTextFiles(reader)) {
+        std::cout << "Text files changed since the last snapshot, loading them instead." << std::endl;
+        return false;
+    }
+
+    users.reserve(reader.userCount());
+    for (size_t i = 0; i < reader.userCount(); ++i) {
+        const snapshot::UserRecord& rec = reader.user(i);
+        std::string id(reader.str(rec.id));
+        if (rec.role > static_cast<uint8_t>(Role::Librarian)) continue;
+        User* user = pools.createUser(static_cast<Role>(rec.role), std::string(reader.str(rec.name)),
+                              std::string(reader.str(rec.email)), id);
+        if (user) {
+            user->setPassword(std::string(reader.str(rec.password)));
+            users.push_back(user);
+            patrons.setUser(id, user);
+        }
+    }
+
+    books.reserve(static_cast<int>(reader.bookCount()));
+    for (size_t i = 0; i < reader.bookCount(); ++i) {
+        const snapshot::BookRecord& rec = reader.book(i);
+        if (rec.status > static_cast<uint8_t>(BookStatus::Reserved)) continue;
+        Book* book = pools.books.create(rec.id, std::string(reader.str(rec.title)), std::string(reader.str(rec.author)),
+                              std::string(reader.str(rec.publisher)), rec.year, std::string(reader.str(rec.isbn)));
+        book->setStatus(static_cast<BookStatus>(rec.status));
+        book->setBorrowedBy(std::string(reader.str(rec.borrowedBy)));
+        if (!books.insert(book)) {
+            pools.books.destroy(book);
+        }
+    }
+
+    accounts.reserve(reader.accountCount());
+    for (size_t i = 0; i < reader.accountCount(); ++i) {
+        const snapshot::AccountRecord& rec = reader.account(i);
+        std::string userId(reader.str(rec.userId));
+        Account* account = pools.accounts.create(userId);
+        account->updateFine(rec.totalFine);
+        account->setFinePaid(rec.finePaid != 0);
+        for (uint32_t j = 0; j < rec.loanCount; ++j) {
+            addRestoredLoan(account, reader.loan(rec.firstLoan + j), clock);
         }
+        accounts.push_back(account);
+        patrons.setAccount(userId, account);
+    }
+    return true;
+}
+
+void Library::saveSnapshot(const snapshot::Checkpoint& saved) const {
+    if (!snapshot::write(dataDir + "/library.snap", saved, users, books, accounts)) {
+        std::cerr << "Error: Failed to write snapshot." << std::endl;
     }
 }
 
-void Library::saveData() {
-    saveUsers();
-    saveBooks();
-    saveAccounts();
+bool Library::saveData(snapshot::Checkpoint& saved) {
+    return saveUsers(saved.textFiles[snapshot::kUsersFile]) && saveBooks(saved.textFiles[snapshot::kBooksFile]) &&
+           saveAccounts(saved.textFiles[snapshot::kAccountsFile]);
 }
 
-void Library::saveUsers() {
-    std::ofstream file(dataDir + "/users.txt");
+bool Library::saveUsers(FileFingerprint& saved) {
+    DurableFile file(dataDir + "/users.txt");
     for (const User* user : users) {
-        file << user->getUserId() << "|"
-             << user->getName() << "|"
-             << user->getEmail() << "|"
-             << user->getPassword() << "|"
-             << user->getRole() << "\n";
+        file.write(formatUser(user));
+        file.write("\n");
     }
+    saved = file.fingerprint();
+    return file.commit();
 }
 
-void Library::saveBooks() {
-    std::ofstream file(dataDir + "/books.txt");
+bool Library::saveBooks(FileFingerprint& saved) {
+    DurableFile file(dataDir + "/books.txt");
     for (const Book* book : books) {
-        file << book->getBookId() << "|"
-             << book->getTitle() << "|"
-             << book->getAuthor() << "|"
-             << book->getPublisher() << "|"
-             << book->getYear() << "|"
-             << book->getIsbn() << "|"
-             << book->getStatus() << "|"
-             << (book->getBorrowedBy().empty() ? "None" : book->getBorrowedBy()) << "\n";
+        file.write(formatBook(book));
+        file.write("\n");
     }
+    saved = file.fingerprint();
+    return file.commit();
 }
 
-void Library::saveAccounts() {
-    std::ofstream file(dataDir + "/accounts.txt");
+bool Library::saveAccounts(FileFingerprint& saved) {
+    DurableFile file(dataDir + "/accounts.txt");
+    std::ostringstream line;
     for (const Account* account : accounts) {
+        line.str("");
         // Save account details
-        file << account->getUserId() << "|"
+        line << account->getUserId() << "|"
              << account->getTotalFine() << "|"
              << (account->isFinePaid() ? "1" : "0") << "\n";
         
@@ -228,15 +625,19 @@ void Library::saveAccounts() {
         const auto& borrowedBooks = account->getCurrentlyBorrowedBooks();
         bool first = true;
         for (const auto& bookId : borrowedBooks) {
-            if (!first) file << "|";
-            file << bookId;
+            if (!first) line << "|";
+            line << bookId;
             first = false;
         }
-        file << "\n";
+        line << "\n";
+        file.write(line.str());
     }
+    saved = file.fingerprint();
+    return file.commit();
 }
 
 void Library::initializeDefaultData() {
+    MutationScope scope(*this);
     // Add default users
     addUser("Admin", "admin@library.com", "admin123", "Librarian", "L001");
     addUser("John Doe", "john@example.com", "student123", "Student", "S001");
@@ -254,56 +655,425 @@ void Library::initializeDefaultData() {
     }
 
     // Save all data
-    saveData();
+    checkpoint();
+}
+
+void Library::replayJournal() {
+    std::vector<JournalRecord> records = journal->readAll();
+    if (records.empty()) return;
+
+    ReplayPositions positions;
+    positions.users.reserve(users.size());
+    for (size_t i = 0; i < users.size(); ++i) positions.users[users[i]->getUserId()] = i;
+    positions.accounts.reserve(accounts.size());
+    for (size_t i = 0; i < accounts.size(); ++i) positions.accounts[accounts[i]->getUserId()] = i;
+
+    for (size_t i = 0; i < records.size(); ++i) {
+        if (!applyJournalRecord(records[i], positions)) {
+            reportMalformedLine("journal.log", i + 1, "invalid journal record");
+        }
+    }
+    // Removed users and accounts were left as gaps
+    users.erase(std::remove(users.begin(), users.end(), nullptr), users.end());
+    accounts.erase(std::remove(accounts.begin(), accounts.end(), nullptr), accounts.end());
+    std::cout << "Replayed " << records.size() << " journal records." << std::endl;
+}
+
+bool Library::applyJournalRecord(const JournalRecord& record, ReplayPositions& positions) {
+    std::string_view fields[8];
+    size_t count = splitFields(record.payload, fields, 8);
+    std::string key(fields[0]);
+    auto field = [&fields](size_t i) { return std::string(fields[i]); };
+    auto destroyUser = [this](User* user) { pools.destroyUser(user); };
+    auto destroyAccount = [this](Account* account) { pools.accounts.destroy(account); };
+
+    switch (record.type) {
+        case kUserRecord: {
+            if (count != 5) return false;
+            User* user = makeUser(pools, fields[4], field(1), field(2), key);
+            if (!user) return false;
+            user->setPassword(field(3));
+            patrons.setUser(key, user);
+            replaceAt(users, positions.users, key, user, destroyUser);
+            return true;
+        }
+        case kUserRemoved: {
+            patrons.setUser(key, nullptr);
+            removeAt(users, positions.users, key, destroyUser);
+            return true;
+        }
+        case kBookRecord: {
+            int bookId, year;
+            BookStatus status;
+            if (count != 8 || !parseInt(fields[0], bookId) || !parseInt(fields[4], year) ||
+                !parseBookStatus(fields[6], status)) {
+                return false;
+            }
+            Book* book = getBook(bookId);
+            if (!book) {
+                book = pools.books.create(bookId, field(1), field(2), field(3), year, field(5));
+                if (!books.insert(book)) {
+                    pools.books.destroy(book);
+                    return false;
+                }
+            } else {
+                book->setTitle(field(1));
+                book->setAuthor(field(2));
+                book->setPublisher(field(3));
+                book->setYear(year);
+                book->setIsbn(field(5));
+            }
+            book->setStatus(status);
+            book->setBorrowedBy(fields[7] == "None" ? "" : field(7));
+            return true;
+        }
+        case kBookRemoved: {
+            int bookId;
+            if (!parseInt(fields[0], bookId)) return false;
+            pools.books.destroy(books.remove(bookId));
+            return true;
+        }
+        case kAccountRecord: {
+            double totalFine;
+            if (count != 4 || !parseDouble(fields[1], totalFine)) return false;
+            Account* account = pools.accounts.create(key);
+            account->updateFine(totalFine);
+            account->setFinePaid(fields[2] == "1");
+            FieldReader loans(fields[3]);
+            std::string_view loan;
+            while (loans.next(loan, ',')) {
+                int bookId;
+                if (parseInt(loan, bookId)) {
+                    addRestoredLoan(account, bookId, clock);
+                }
+            }
+            patrons.setAccount(key, account);
+            replaceAt(accounts, positions.accounts, key, account, destroyAccount);
+            return true;
+        }
+        case kAccountRemoved: {
+            patrons.setAccount(key, nullptr);
+            removeAt(accounts, positions.accounts, key, destroyAccount);
+            return true;
+        }
+        default:
+            return false;
+    }
+}
+
+// Folds the journal into the data files and starts a fresh journal
+void Library::checkpoint() {
+    MutationScope scope(*this);
+    std::lock_guard<std::mutex> lock(journalMutex);
+    journal->sync();
+    // Until every file is durable the journal is still needed: replaying it
+    // over whichever files a crash left in place restores the same state.
+    // The snapshot goes last, so it never names text files that are not in
+    // place; if it fails, the old one no longer matches and is ignored.
+    snapshot::Checkpoint saved{};
+    saved.generation = checkpointGeneration + 1;
+    if (!saveData(saved)) {
+        std::cerr << "Error: Failed to write the data files; keeping the journal." << std::endl;
+        return;
+    }
+    saveSnapshot(saved);
+    if (!syncDirectory(dataDir)) {
+        std::cerr << "Error: Failed to sync the data directory; keeping the journal." << std::endl;
+        return;
+    }
+    checkpointGeneration = saved.generation;
+    journal->reset();
+    clearDirty();
+}
+
+void Library::checkpointIfJournalExceeds(uint64_t maxJournalBytes) {
+    {
+        std::lock_guard<std::mutex> lock(journalMutex);
+        if (static_cast<uint64_t>(journal->getSize()) <= maxJournalBytes) return;
+    }
+    checkpoint();
+}
+
+void Library::clearDirty() {
+    std::lock_guard<std::mutex> lock(dirtyMutex);
+    dirtyUsers.clear();
+    dirtyBooks.clear();
+    dirtyAccounts.clear();
+    pendingOperations = 0;
+}
+
+thread_local Library::MutationScope* Library::activeScope = nullptr;
+thread_local const Library* Library::lockingLibrary = nullptr;
+
+Library::MutationScope::MutationScope(Library& lib)
+    : library(lib), outer(activeScope), previous(lockingLibrary), owner(lockingLibrary != &lib), exclusive(true),
+      accountStripe(nullptr), bookStripe(nullptr) {
+    if (!owner) return;
+    library.structureMutex.lock();
+    lockingLibrary = &library;
+    activeScope = this;
+}
+
+Library::MutationScope::MutationScope(Library& lib, const std::string& userId, int bookId)
+    : library(lib), outer(activeScope), previous(lockingLibrary), owner(lockingLibrary != &lib), exclusive(false),
+      accountStripe(nullptr), bookStripe(nullptr) {
+    if (!owner) return;
+    library.structureMutex.lock_shared();
+    accountStripe = &library.accountStripe(userId);
+    accountStripe->lock();
+    if (bookId >= 0) {
+        bookStripe = &library.bookStripe(bookId);
+        bookStripe->lock();
+    }
+    lockingLibrary = &library;
+    activeScope = this;
+}
+
+Library::MutationScope::~MutationScope() {
+    if (!owner) return;
+    bool dirtied = !users.empty() || !books.empty() || !accounts.empty();
+    keepLastMarks(users);
+    keepLastMarks(books);
+    keepLastMarks(accounts);
+    library.recordDirty(*this);
+    library.publishBooks(*this);
+    if (bookStripe) bookStripe->unlock();
+    if (accountStripe) accountStripe->unlock();
+    if (dirtied) library.commitOperation();
+    activeScope = outer;
+    lockingLibrary = previous;
+    if (exclusive) {
+        library.structureMutex.unlock();
+    } else {
+        library.structureMutex.unlock_shared();
+    }
+}
+
+Library::ReadScope::ReadScope(const Library& lib)
+    : library(lib), previous(lockingLibrary), owner(lockingLibrary != &lib) {
+    if (!owner) return;
+    library.structureMutex.lock_shared();
+    lockingLibrary = &library;
+}
+
+Library::ReadScope::~ReadScope() {
+    if (!owner) return;
+    lockingLibrary = previous;
+    library.structureMutex.unlock_shared();
+}
+
+std::mutex& Library::accountStripe(const std::string& userId) const {
+    return accountStripes[std::hash<std::string>()(userId) % kLockStripes];
+}
+
+std::mutex& Library::bookStripe(int bookId) const {
+    return bookStripes[static_cast<size_t>(bookId) % kLockStripes];
+}
+
+// Changes are noted in the operation's scope and journaled when it ends,
+// so the record shows the entity as the operation left it
+void Library::markUserDirty(const std::string& userId, DirtyState state) {
+    if (activeScope && &activeScope->library == this) {
+        activeScope->users.emplace_back(userId, state);
+    } else {
+        MutationScope scope(*this);
+        scope.users.emplace_back(userId, state);
+    }
+}
+
+void Library::markBookDirty(int bookId, DirtyState state) {
+    if (activeScope && &activeScope->library == this) {
+        activeScope->books.emplace_back(bookId, state);
+    } else {
+        MutationScope scope(*this);
+        scope.books.emplace_back(bookId, state);
+    }
+}
+
+void Library::markAccountDirty(const std::string& userId, DirtyState state) {
+    if (activeScope && &activeScope->library == this) {
+        activeScope->accounts.emplace_back(userId, state);
+    } else {
+        MutationScope scope(*this);
+        scope.accounts.emplace_back(userId, state);
+    }
+}
+
+// Formats the journal records of what a scope changed; its locks cover
+// every entity it marked
+void Library::recordDirty(MutationScope& scope) {
+    std::vector<std::pair<std::string, DirtyRecord>> userRecords, accountRecords;
+    std::vector<std::pair<int, DirtyRecord>> bookRecords;
+    for (const auto& entry : scope.users) {
+        const User* user = entry.second == DirtyState::Updated ? getUser(entry.first) : nullptr;
+        userRecords.emplace_back(entry.first, user ? DirtyRecord{kUserRecord, formatUser(user)}
+                                                   : DirtyRecord{kUserRemoved, entry.first});
+    }
+    for (const auto& entry : scope.books) {
+        const Book* book = entry.second == DirtyState::Updated ? getBook(entry.first) : nullptr;
+        bookRecords.emplace_back(entry.first, book ? DirtyRecord{kBookRecord, formatBook(book)}
+                                                   : DirtyRecord{kBookRemoved, std::to_string(entry.first)});
+    }
+    for (const auto& entry : scope.accounts) {
+        const Account* account = entry.second == DirtyState::Updated ? getAccount(entry.first) : nullptr;
+        accountRecords.emplace_back(entry.first, account ? DirtyRecord{kAccountRecord, formatAccount(account)}
+                                                         : DirtyRecord{kAccountRemoved, entry.first});
+    }
+
+    std::lock_guard<std::mutex> lock(dirtyMutex);
+    for (auto& entry : userRecords) dirtyUsers[entry.first] = std::move(entry.second);
+    for (auto& entry : bookRecords) dirtyBooks[entry.first] = std::move(entry.second);
+    for (auto& entry : accountRecords) dirtyAccounts[entry.first] = std::move(entry.second);
+}
+
+// Publishes the books a scope changed as the next catalog version, while
+// its locks still cover them
+void Library::publishBooks(const MutationScope& scope) {
+    if (scope.books.empty()) return;
+    PublishedCatalog::Update update(publishedCatalog);
+    for (const auto& entry : scope.books) {
+        const Book* book = entry.second == DirtyState::Updated ? getBook(entry.first) : nullptr;
+        if (book) {
+            update.setBook(*book);
+        } else {
+            update.removeBook(entry.first);
+        }
+    }
+}
+
+// Counts a finished operation that changed something and flushes if the
+// commit policy asks for it
+void Library::commitOperation() {
+    bool due;
+    {
+        std::lock_guard<std::mutex> lock(dirtyMutex);
+        ++pendingOperations;
+        due = commitPolicy == CommitPolicy::Immediate ||
+              (commitPolicy == CommitPolicy::EveryNOperations && pendingOperations >= commitParameter);
+    }
+    if (due) flush();
+}
+
+bool Library::flush() {
+    std::lock_guard<std::mutex> lock(journalMutex);
+    return flushLocked();
+}
+
+// Writes the pending records, then commits them with one fsync. Records
+// are taken and written under the journal lock, so they reach the journal
+// in the order the operations ended. If the journal fails they are put
+// back, behind anything changed since, to be written by the next flush.
+bool Library::flushLocked() {
+    std::unordered_map<std::string, DirtyRecord> userRecords, accountRecords;
+    std::unordered_map<int, DirtyRecord> bookRecords;
+    {
+        std::lock_guard<std::mutex> lock(dirtyMutex);
+        userRecords.swap(dirtyUsers);
+        bookRecords.swap(dirtyBooks);
+        accountRecords.swap(dirtyAccounts);
+        pendingOperations = 0;
+    }
+    if (userRecords.empty() && bookRecords.empty() && accountRecords.empty()) return true;
+
+    bool written = true;
+    auto append = [&](const DirtyRecord& record) {
+        written = written && journal->append(record.type, record.payload);
+    };
+    for (const auto& entry : userRecords) append(entry.second);
+    for (const auto& entry : bookRecords) append(entry.second);
+    for (const auto& entry : accountRecords) append(entry.second);
+    if (written && journal->sync()) return true;
+
+    std::cerr << "Error: Changes could not be committed to the journal; they will be retried." << std::endl;
+    std::lock_guard<std::mutex> lock(dirtyMutex);
+    dirtyUsers.insert(userRecords.begin(), userRecords.end());
+    dirtyBooks.insert(bookRecords.begin(), bookRecords.end());
+    dirtyAccounts.insert(accountRecords.begin(), accountRecords.end());
+    return false;
+}
+
+void Library::setCommitPolicy(CommitPolicy policy, size_t parameter) {
+    stopFlusherThread();
+    {
+        std::unique_lock<std::shared_mutex> structure(structureMutex);
+        std::lock_guard<std::mutex> lock(journalMutex);
+        flushLocked();
+        commitPolicy = policy;
+        commitParameter = parameter > 0 ? parameter : 1;
+    }
+    if (policy == CommitPolicy::Interval) {
+        startFlusher();
+    }
+}
+
+void Library::startFlusher() {
+    stopFlusher = false;
+    flusher = std::thread([this] {
+        std::unique_lock<std::mutex> lock(journalMutex);
+        while (!stopFlusher) {
+            flusherCv.wait_for(lock, std::chrono::milliseconds(commitParameter));
+            flushLocked();
+        }
+    });
+}
+
+void Library::stopFlusherThread() {
+    if (!flusher.joinable()) return;
+    {
+        std::lock_guard<std::mutex> lock(journalMutex);
+        stopFlusher = true;
+    }
+    flusherCv.notify_all();
+    flusher.join();
 }
 
 User* Library::addUser(const std::string& name, const std::string& email, 
                       const std::string& password, const std::string& type, const std::string& id) {
-    User* user = nullptr;
-    
-    if (type == "Student") {
-        user = new Student(name, email, id);
-    } else if (type == "Faculty") {
-        user = new Faculty(name, email, id);
-    } else if (type == "Librarian") {
-        user = new Librarian(name, email, id);
-    }
+    MutationScope scope(*this);
+    User* user = makeUser(pools, type, name, email, id);
 
     if (user) {
         user->setPassword(password);
         users.push_back(user);
-        userMap[id] = user;
-        saveUsers();
+        patrons.setUser(id, user);
+        markUserDirty(user->getUserId());
     }
     return user;
 }
 
 Book* Library::addBook(const std::string& title, const std::string& author,
                       const std::string& publisher, int year, const std::string& isbn) {
+    MutationScope scope(*this);
+    if (const Book* existing = isbnIndex.find(isbn)) {
+        std::cout << "Error: ISBN " << isbn << " is already used by book ID "
+                  << existing->getBookId() << "." << std::endl;
+        return nullptr;
+    }
     int bookId = generateBookId();
-    Book* book = new Book(bookId, title, author, publisher, year, isbn);
-    books.push_back(book);
-    bookMap[bookId] = book;
-    saveBooks();
+    Book* book = pools.books.create(bookId, title, author, publisher, year, isbn);
+    books.insert(book);
+    indexBook(book);
+    markBookDirty(book->getBookId());
     return book;
 }
 
 Account* Library::createAccount(User* user) {
+    MutationScope scope(*this);
     if (!user) return nullptr;
     
-    Account* account = new Account(user->getUserId());
+    Account* account = pools.accounts.create(user->getUserId());
     accounts.push_back(account);
-    accountMap[user->getUserId()] = account;
-    saveAccounts();
+    patrons.setAccount(user->getUserId(), account);
+    markAccountDirty(account->getUserId());
     return account;
 }
 
 bool Library::borrowBook(const std::string& userId, int bookId) {
-    User* user = getUser(userId);
+    MutationScope scope(*this, userId, bookId);
+    Patron patron = getPatron(userId);
     Book* book = getBook(bookId);
-    Account* account = getAccount(userId);
 
-    if (!user || !book || !account) return false;
+    if (!patron.user || !patron.account || !book) return false;
     if (!book->isAvailable()) return false;
 
     // Check if the book is reserved for someone else
@@ -313,52 +1083,93 @@ bool Library::borrowBook(const std::string& userId, int bookId) {
         return false;
     }
 
-    // If the book was reserved for this user and the reservation expired, remove it
-    if (book->isReservationExpired() && book->getNextReservation() == userId) {
-        book->removeExpiredReservation();
-    }
+    const RolePolicy& policy = patron.user->getPolicy();
+    size_t borrowedCount = patron.account->getCurrentlyBorrowedBooks().size();
+    if (!policy.canBorrow) return false;
 
-    // For faculty members, check if they have any currently borrowed books
-    if (user->getRole() == "Faculty" && !account->getCurrentlyBorrowedBooks().empty()) {
-        return false;  // Faculty cannot borrow if they have any unreturned books
-    }
+    // Faculty cannot borrow if they have any unreturned books
+    if (policy.mustReturnBeforeBorrow && borrowedCount > 0) return false;
+    if (borrowedCount >= static_cast<size_t>(policy.maxBorrowLimit)) return false;
+
+    applyBorrow(patron, book);
+    return true;
+}
 
-    // For other users, check if they can borrow
-    if (!user->canBorrowBook()) return false;
+// Lends the book; the caller has checked that the patron may borrow it
+void Library::applyBorrow(const Patron& patron, Book* book) {
+    User* user = patron.user;
+    Account* account = patron.account;
+    const std::string& userId = user->getUserId();
+    int bookId = book->getBookId();
 
-    // Get current time for borrow date
-    time_t now = time(0);
-    char* dt = ctime(&now);
-    std::string borrowDate(dt);
-    borrowDate = borrowDate.substr(0, borrowDate.length() - 1);
+    // If the book was reserved for this user and the reservation expired, remove it
+    time_t now = clock.now();
+    if (book->isReservationExpired(now) && book->getNextReservation() == userId) {
+        book->removeExpiredReservation(now);
+        unindexReservation(userId, bookId);
+    }
 
-    // Calculate due date based on user type (10 seconds = 1 day for testing)
-    now += user->getMaxBorrowPeriod() * 10; // 10 seconds per day for testing
-    dt = ctime(&now);
-    std::string dueDate(dt);
-    dueDate = dueDate.substr(0, dueDate.length() - 1);
+    // Due date based on user type
+    const RolePolicy& policy = user->getPolicy();
+    time_t borrowDate = now;
+    time_t dueDate = borrowDate + clock.days(policy.loanDays);
 
     book->markAsBorrowed(userId);
-    account->addBorrowedBook(bookId, borrowDate, dueDate);
+    {
+        std::lock_guard<std::mutex> lock(catalogMutex);
+        catalogIndex.setStatus(bookId, BookStatus::Available, book->getStatusCode());
+    }
+    size_t record = account->addBorrowedBook(bookId, borrowDate, dueDate);
+    {
+        std::lock_guard<std::mutex> lock(loanMutex);
+        scheduleFine(userId, policy, record);
+        loanTable.add(account, user->getRole(), record);
+    }
     
     // If this user had reserved the book, remove the reservation
-    if (book->hasReservation(userId)) {
-        book->cancelReservation(userId);
+    if (book->cancelReservation(userId)) {
+        unindexReservation(userId, bookId);
     }
     
-    saveBooks();
-    saveAccounts();
-    return true;
+    markBookDirty(book->getBookId());
+    markAccountDirty(account->getUserId());
 }
 
 bool Library::returnBook(const std::string& userId, int bookId) {
+    MutationScope scope(*this, userId, bookId);
     Book* book = getBook(bookId);
-    Account* account = getAccount(userId);
+    Patron patron = getPatron(userId);
 
-    if (!book || !account) return false;
+    if (!book || !patron.account) return false;
     if (book->getBorrowedBy() != userId) return false;
 
+    applyReturn(patron, book);
+    return true;
+}
+
+// Takes the book back; the caller has checked that it is on loan to the
+// patron, whose account must exist
+void Library::applyReturn(const Patron& patron, Book* book) {
+    Account* account = patron.account;
+    int bookId = book->getBookId();
+
+    // Charge the fine up to the return; the loan's timer is then stale
+    size_t record = account->findActiveLoan(bookId);
+    if (patron.user && record != SIZE_MAX) {
+        accrueFine(account, patron.user->getPolicy(), record, clock.now());
+    }
+
+    BookStatus previous = book->getStatusCode();
     book->markAsReturned();
+    {
+        std::lock_guard<std::mutex> lock(catalogMutex);
+        catalogIndex.setStatus(bookId, previous, book->getStatusCode());
+    }
+    offerToNextReservation(book);
+    {
+        std::lock_guard<std::mutex> lock(loanMutex);
+        loanTable.remove(account, bookId);
+    }
     account->removeBorrowedBook(bookId);
     
     // Check if there are any reservations
@@ -367,12 +1178,80 @@ bool Library::returnBook(const std::string& userId, int bookId) {
         notifyUserAboutReservation(nextUser, bookId);
     }
     
-    saveBooks();
-    saveAccounts();
+    markBookDirty(book->getBookId());
+    markAccountDirty(account->getUserId());
+}
+
+// Runs alone, so nothing changes between the checks and the changes. Each
+// user and book is looked up once however many requests name it, and the
+// whole batch is journaled as one operation.
+bool Library::applyBatch(const std::vector<CirculationRequest>& requests, std::vector<CirculationResult>& results) {
+    MutationScope scope(*this);
+    results.assign(requests.size(), CirculationResult{CirculationResult::Outcome::Applied, ""});
+
+    std::unordered_map<std::string, PendingPatron> pendingPatrons;
+    std::unordered_map<int, PendingBook> pendingBooks;
+    std::vector<std::pair<const PendingPatron*, const PendingBook*>> resolved;
+    resolved.reserve(requests.size());
+    bool refused = false;
+    for (size_t i = 0; i < requests.size(); ++i) {
+        const CirculationRequest& request = requests[i];
+        auto patron = pendingPatrons.find(request.userId);
+        if (patron == pendingPatrons.end()) {
+            PendingPatron pending{patrons.find(request.userId), 0};
+            if (pending.patron.account) pending.borrowed = pending.patron.account->getCurrentlyBorrowedBooks().size();
+            patron = pendingPatrons.emplace(request.userId, pending).first;
+        }
+        auto book = pendingBooks.find(request.bookId);
+        if (book == pendingBooks.end()) {
+            Book* found = getBook(request.bookId);
+            PendingBook pending{found, BookStatus::Available, "", {}};
+            if (found) {
+                pending.status = found->getStatusCode();
+                pending.borrowedBy = found->getBorrowedBy();
+                pending.queue = found->getReservedUserIds();
+            }
+            book = pendingBooks.emplace(request.bookId, std::move(pending)).first;
+        }
+        resolved.emplace_back(&patron->second, &book->second);
+
+        std::string reason = admit(request, patron->second, book->second);
+        if (!reason.empty()) {
+            results[i] = CirculationResult{CirculationResult::Outcome::Refused, reason};
+            refused = true;
+        }
+    }
+
+    if (refused) {
+        for (CirculationResult& result : results) {
+            if (result.outcome == CirculationResult::Outcome::Applied) {
+                result = CirculationResult{CirculationResult::Outcome::NotApplied,
+                                           "Another request in the batch was refused."};
+            }
+        }
+        return false;
+    }
+
+    for (size_t i = 0; i < requests.size(); ++i) {
+        const Patron& patron = resolved[i].first->patron;
+        Book* book = resolved[i].second->book;
+        switch (requests[i].action) {
+        case CirculationRequest::Action::Borrow:
+            applyBorrow(patron, book);
+            break;
+        case CirculationRequest::Action::Return:
+            applyReturn(patron, book);
+            break;
+        case CirculationRequest::Action::Reserve:
+            applyReserve(requests[i].userId, book);
+            break;
+        }
+    }
     return true;
 }
 
 User* Library::authenticateUser(const std::string& userId, const std::string& password) {
+    ReadScope read(*this);
     User* user = getUser(userId);
     if (user && user->getPassword() == password) {
         return user;
@@ -382,30 +1261,31 @@ User* Library::authenticateUser(const std::string& userId, const std::string& pa
 
 // Helper methods
 User* Library::getUser(const std::string& userId) const {
-    auto it = userMap.find(userId);
-    return it != userMap.end() ? it->second : nullptr;
+    return patrons.findUser(userId);
 }
 
 Book* Library::getBook(int bookId) const {
-    auto it = bookMap.find(bookId);
-    return it != bookMap.end() ? it->second : nullptr;
+    return books.get(bookId);
+}
+
+// Hyphens, spaces and the case of a check digit X are ignored
+Book* Library::findBookByIsbn(const std::string& isbn) const {
+    ReadScope read(*this);
+    const Book* book = isbnIndex.find(isbn);
+    return book ? books.get(book->getBookId()) : nullptr;
 }
 
 Account* Library::getAccount(const std::string& userId) const {
-    auto it = accountMap.find(userId);
-    return it != accountMap.end() ? it->second : nullptr;
+    return patrons.findAccount(userId);
 }
 
 int Library::generateBookId() const {
-    int maxId = 0;
-    for (const Book* book : books) {
-        maxId = std::max(maxId, book->getBookId());
-    }
-    return maxId + 1;
+    return books.nextId();
 }
 
 // User management
 bool Library::removeUser(const std::string& userId) {
+    MutationScope scope(*this);
     auto userIt = std::find_if(users.begin(), users.end(),
         [userId](const User* u) { return u->getUserId() == userId; });
     
@@ -424,19 +1304,35 @@ bool Library::removeUser(const std::string& userId) {
             }
         }
 
-        delete *userIt;
+        // Drop the user's place in every reservation queue; a book held for
+        // the user goes to the next in line, as on cancelReservation
+        auto& shard = reservationShard(userId);
+        auto reserved = shard.find(userId);
+        if (reserved != shard.end()) {
+            for (int bookId : reserved->second) {
+                if (Book* book = getBook(bookId)) {
+                    book->cancelReservation(userId);
+                    offerToNextReservation(book);
+                    markBookDirty(bookId);
+                }
+            }
+            shard.erase(reserved);
+        }
+
+        patrons.setUser(userId, nullptr);
+        pools.destroyUser(*userIt);
         users.erase(userIt);
-        userMap.erase(userId);
         
         auto accountIt = std::find_if(accounts.begin(), accounts.end(),
             [userId](const Account* a) { return a->getUserId() == userId; });
         
+        patrons.setAccount(userId, nullptr);
         if (accountIt != accounts.end()) {
-            delete *accountIt;
+            pools.accounts.destroy(*accountIt);
             accounts.erase(accountIt);
         }
-        saveUsers();
-        saveAccounts();
+        markUserDirty(userId, DirtyState::Removed);
+        markAccountDirty(userId, DirtyState::Removed);
         return true;
     }
     return false;
@@ -448,11 +1344,10 @@ const std::vector<User*>& Library::getAllUsers() const {
 
 // Book management
 bool Library::removeBook(int bookId) {
-    auto bookIt = std::find_if(books.begin(), books.end(),
-        [bookId](const Book* b) { return b->getBookId() == bookId; });
+    MutationScope scope(*this);
+    Book* book = books.get(bookId);
     
-    if (bookIt != books.end()) {
-        Book* book = *bookIt;
+    if (book) {
         // Check if the book is currently borrowed
         if (!book->isAvailable()) {
             std::cout << "Error: Cannot remove book. The book is currently borrowed by user: " 
@@ -460,52 +1355,200 @@ bool Library::removeBook(int bookId) {
             return false;
         }
 
-        delete book;
-        books.erase(bookIt);
-        bookMap.erase(bookId);
-        saveBooks();
+        for (const std::string& userId : book->getReservedUserIds()) {
+            unindexReservation(userId, bookId);
+        }
+        unindexBook(book);
+        pools.books.destroy(books.remove(bookId));
+        markBookDirty(bookId, DirtyState::Removed);
         return true;
     }
     return false;
 }
 
-const std::vector<Book*>& Library::getAllBooks() const {
-    return books;
+std::vector<Book*> Library::getAllBooks() const {
+    ReadScope read(*this);
+    return books.toVector();
+}
+
+std::vector<Book*> Library::searchBooks(const std::string& query, size_t limit) const {
+    ReadScope read(*this);
+    std::vector<Book*> results;
+    for (const SearchHit& hit : searchIndex.search(query, limit)) {
+        results.push_back(books.get(hit.bookId));
+    }
+    return results;
+}
+
+// Typo-tolerant search over titles and authors; `suggestion` receives the
+// corrected query, or stays empty if nothing needed correcting
+std::vector<Book*> Library::fuzzySearchBooks(const std::string& query, std::string& suggestion, size_t limit) const {
+    ReadScope read(*this);
+    std::vector<Book*> results;
+    for (const SearchHit& hit : searchIndex.searchFuzzy(query, limit, suggestion)) {
+        results.push_back(books.get(hit.bookId));
+    }
+    return results;
+}
+
+// Books whose title, author or publisher contains `text`, ignoring case, in
+// id order. Scans the whole catalog, so it is meant for filters the word
+// indexes cannot answer.
+std::vector<Book*> Library::findBooksContaining(const std::string& text, size_t limit) const {
+    ReadScope read(*this);
+    std::vector<Book*> results;
+    for (int bookId : bookText.find(text, ScanEngine::kAnyField, limit)) {
+        results.push_back(books.get(bookId));
+    }
+    return results;
+}
+
+// What the search box does with a query: an ISBN finds that book, text in
+// double quotes is looked for inside titles, authors and publishers, a
+// trailing * completes a title or author, and anything else is a word
+// search that falls back to substrings and then to typos. `suggestion`
+// receives the corrected query when typos were allowed for.
+std::vector<Book*> Library::findBooks(const std::string& query, std::string& suggestion) const {
+    suggestion.clear();
+    if (Book* book = findBookByIsbn(query)) {
+        return {book};
+    }
+    if (query.size() >= 2 && query.front() == '"' && query.back() == '"') {
+        return findBooksContaining(query.substr(1, query.size() - 2));
+    }
+    if (!query.empty() && query.back() == '*') {
+        return autocompleteBooks(query.substr(0, query.size() - 1));
+    }
+    std::vector<Book*> results = searchBooks(query);
+    if (results.empty()) {
+        // No whole word matched; the text may be part of a word or punctuation
+        results = findBooksContaining(query);
+    }
+    if (results.empty()) {
+        // Nothing matched as typed; retry allowing for typos
+        results = fuzzySearchBooks(query, suggestion);
+    }
+    return results;
+}
+
+// Books meeting every condition of `filter`, in id order
+std::vector<Book*> Library::filterBooks(const BookFilter& filter, size_t limit) const {
+    ReadScope read(*this);
+    std::vector<Book*> results;
+    Bitmap matched;
+    {
+        std::lock_guard<std::mutex> lock(catalogMutex);
+        matched = catalogIndex.match(filter);
+    }
+    matched.forEach([this, &results, limit](uint32_t bookId) {
+        if (results.size() == limit) return false;
+        results.push_back(books.get(static_cast<int>(bookId)));
+        return true;
+    });
+    return results;
+}
+
+size_t Library::countBooks(const BookFilter& filter) const {
+    ReadScope read(*this);
+    std::lock_guard<std::mutex> lock(catalogMutex);
+    return catalogIndex.match(filter).cardinality();
+}
+
+PublishedCatalog::Reader Library::readCatalog() const {
+    return PublishedCatalog::Reader(publishedCatalog);
+}
+
+// Books whose title or author starts with `prefix`, in alphabetical order
+std::vector<Book*> Library::autocompleteBooks(const std::string& prefix, size_t limit) const {
+    ReadScope read(*this);
+    std::string key = normalizeText(prefix);
+
+    // A book can match by both title and author, so twice the entries always
+    // hold `limit` distinct books
+    std::vector<Book*> results;
+    for (int bookId : prefixIndex.complete(key, limit * 2)) {
+        Book* book = books.get(bookId);
+        if (book && std::find(results.begin(), results.end(), book) == results.end()) {
+            results.push_back(book);
+            if (results.size() == limit) break;
+        }
+    }
+    return results;
+}
+
+bool Library::indexBook(const Book* book) {
+    searchIndex.add(*book);
+    prefixIndex.insert(normalizeText(book->getTitle()), book->getBookId());
+    prefixIndex.insert(normalizeText(book->getAuthor()), book->getBookId());
+    bookText.add(*book);
+    catalogIndex.add(*book);
+    return isbnIndex.insert(book);
+}
+
+void Library::unindexBook(const Book* book) {
+    searchIndex.remove(*book);
+    prefixIndex.remove(normalizeText(book->getTitle()), book->getBookId());
+    prefixIndex.remove(normalizeText(book->getAuthor()), book->getBookId());
+    bookText.remove(book->getBookId());
+    catalogIndex.remove(*book);
+    isbnIndex.remove(book);
+}
+
+void Library::rebuildBookIndexes() {
+    searchIndex.clear();
+    prefixIndex.clear();
+    bookText.clear();
+    catalogIndex.clear();
+    isbnIndex.clear();
+    isbnIndex.reserve(books.size());
+    size_t duplicateIsbns = 0;
+    PublishedCatalog::Update update(publishedCatalog);
+    for (const Book* book : books) {
+        if (!indexBook(book)) ++duplicateIsbns;
+        update.setBook(*book);
+    }
+    if (duplicateIsbns > 0) {
+        std::cerr << "Warning: " << duplicateIsbns << " books reuse the ISBN of an earlier book; "
+                  << "ISBN lookup finds the earliest." << std::endl;
+    }
 }
 
 // Account management
 bool Library::removeAccount(const std::string& accountId) {
+    MutationScope scope(*this);
     auto accountIt = std::find_if(accounts.begin(), accounts.end(),
         [accountId](const Account* a) { return a->getUserId() == accountId; });
     
     if (accountIt != accounts.end()) {
-        delete *accountIt;
+        patrons.setAccount(accountId, nullptr);
+        loanTable.removeAccount(*accountIt);
+        pools.accounts.destroy(*accountIt);
         accounts.erase(accountIt);
-        accountMap.erase(accountId);
-        saveAccounts();
+        markAccountDirty(accountId, DirtyState::Removed);
         return true;
     }
     return false;
 }
 
 Account* Library::getAccountByUserId(const std::string& userId) const {
-    for (Account* account : accounts) {
-        if (account->getUserId() == userId) {
-            return account;
-        }
-    }
-    return nullptr;
+    return getAccount(userId);
+}
+
+// Takes no lock: PatronIndex lookups are safe alongside its writers
+Patron Library::getPatron(const std::string& userId) const {
+    return patrons.find(userId);
 }
 
 // Library operations
 void Library::payFine(const std::string& userId, double amount) {
+    MutationScope scope(*this, userId, -1);
     Account* account = getAccountByUserId(userId);
     if (account) {
         account->updateFine(-amount);
         if (account->getTotalFine() <= 0) {
             account->setFinePaid(true);
         }
-        saveAccounts();
+        markAccountDirty(account->getUserId());
     }
 }
 
@@ -513,85 +1556,241 @@ void Library::updateFines() {
     calculateFines();
 }
 
+// Charges the fines that grew since the last sweep. Only loans whose fine
+// increased are visited; each is then rescheduled for its next increase.
 void Library::calculateFines() {
+    MutationScope scope(*this);
+    time_t now = clock.now();
+    dueLoans.popDue(now, [this, now](const DueLoan& loan) {
+        Patron patron = getPatron(loan.userId);
+        if (!patron.user || !patron.account) return;
+        Account* account = patron.account;
+        const std::vector<BorrowRecord>& history = account->getBorrowHistory();
+        if (loan.record >= history.size() || history[loan.record].bookId != loan.bookId ||
+            history[loan.record].returned) {
+            return;
+        }
+        const RolePolicy& policy = patron.user->getPolicy();
+        accrueFine(account, policy, loan.record, now);
+        dueLoans.push(nextFineIncrease(policy, history[loan.record].dueDate, now, clock.secondsPerDay()), loan);
+    });
+}
+
+// Charges every unreturned loan up to its current fine in one pass over the
+// loan table instead of one heap pop per loan, for full runs such as month
+// end when most active loans are overdue. Totals match calculateFines, and
+// the fine timers stay valid: one firing later only charges what is left.
+void Library::calculateFinesBatch() {
+    MutationScope scope(*this);
+    loanTable.computeFines(clock.now(), clock.secondsPerDay());
+    loanTable.forEachFine([this](Account* account, size_t record, double fine) {
+        if (fine > account->getBorrowHistory()[record].fine) {
+            account->chargeFine(record, fine);
+            markAccountDirty(account->getUserId());
+        }
+    });
+}
+
+void Library::accrueFine(Account* account, const RolePolicy& policy, size_t record, time_t now) {
+    const BorrowRecord& loan = account->getBorrowHistory()[record];
+    double fine = fineAt(policy, loan.dueDate, now, clock.secondsPerDay());
+    if (fine > loan.fine) {
+        account->chargeFine(record, fine);
+        markAccountDirty(account->getUserId());
+    }
+}
+
+void Library::scheduleFine(const std::string& userId, const RolePolicy& policy, size_t record) {
+    if (policy.finePerDay <= 0) return;
+    const Account* account = getAccount(userId);
+    const BorrowRecord& loan = account->getBorrowHistory()[record];
+    dueLoans.push(nextFineIncrease(policy, loan.dueDate, loan.dueDate, clock.secondsPerDay()), DueLoan{userId, record, loan.bookId});
+}
+
+// Queues every unreturned loan and fills the loan table after loading
+void Library::rebuildLoanIndexes() {
+    dueLoans.clear();
+    loanTable.clear();
     for (Account* account : accounts) {
-        double totalFine = 0.0;
+        const User* user = getUser(account->getUserId());
+        if (!user) continue;
         for (int bookId : account->getCurrentlyBorrowedBooks()) {
-            totalFine += calculateFine(account->getUserId(), bookId);
+            size_t record = account->findActiveLoan(bookId);
+            if (record == SIZE_MAX) continue;
+            scheduleFine(account->getUserId(), user->getPolicy(), record);
+            loanTable.add(account, user->getRole(), record);
         }
-        account->updateFine(totalFine);
     }
-    saveAccounts();
 }
 
 double Library::calculateFine(const std::string& userId, int bookId) const {
-    User* user = getUser(userId);
-    Book* book = getBook(bookId);
-    Account* account = getAccountByUserId(userId);
-
-    if (!user || !book || !account) {
+    ReadScope read(*this);
+    std::lock_guard<std::mutex> lock(accountStripe(userId));
+    Patron patron = getPatron(userId);
+    if (!patron.user || !patron.account || !getBook(bookId)) {
         return 0.0;
     }
-
-    // Get the borrow record for this book
-    for (const BorrowRecord& record : account->getBorrowHistory()) {
-        if (record.bookId == bookId && !record.returned) {
-            // Calculate days overdue
-            time_t now = time(0);
-            struct tm due = {};
-            std::stringstream ss(record.dueDate);
-            ss >> std::get_time(&due, "%a %b %d %H:%M:%S %Y");
-            
-            if (ss.fail()) {
-                return 0.0;
-            }
-            
-            time_t dueTime = mktime(&due);
-            double diff = difftime(now, dueTime);
-            
-            if (diff < 0) {
-                return 0.0;
-            }
-            
-            // Convert seconds to days (10 seconds = 1 day for testing)
-            int daysOverdue = static_cast<int>(diff / 10);
-            
-            // Calculate fine based on user type, starting after 15 days
-            if (user->getRole() == "Student" && daysOverdue > 15) {
-                return (daysOverdue - 15) * 10.0; // 10 rupees per day for students, after 15 days
-            } else if (user->getRole() == "Faculty") {
-                return 0.0; // No fine for faculty
-            }
-        }
-    }
-    
-    return 0.0;
+    size_t record = patron.account->findActiveLoan(bookId);
+    if (record == SIZE_MAX) return 0.0;
+    return fineAt(patron.user->getPolicy(), patron.account->getBorrowHistory()[record].dueDate,
+                  clock.now(), clock.secondsPerDay());
 }
 
 void Library::displayAllBooks() const {
+    PublishedCatalog::Reader catalog = readCatalog();
     std::cout << "Library Books:" << std::endl;
+    catalog.forEachBook([](const BookView& book) {
+        std::cout << "ID: " << book.getBookId()
+                  << ", Title: " << book.getTitle()
+                  << ", Author: " << book.getAuthor()
+                  << ", Status: " << book.getStatus()
+                  << ", Borrowed By: " << book.getBorrowedBy() << std::endl;
+    });
+}
+
+void Library::displayAvailableBooks() const {
+    PublishedCatalog::Reader catalog = readCatalog();
+    std::cout << "Available Books:" << std::endl;
+    catalog.forEachBook([](const BookView& book) {
+        if (!book.isAvailable()) return;
+        std::cout << "ID: " << book.getBookId()
+                  << ", Title: " << book.getTitle()
+                  << ", Author: " << book.getAuthor()
+                  << ", Publisher: " << book.getPublisher()
+                  << ", Year: " << book.getYear() << std::endl;
+    });
+}
+
+// Counts of the books matching `filter` by status, decade and publisher,
+// followed by the first few of them. Every count is a bitmap intersection.
+void Library::displayCatalogReport(const BookFilter& filter) const {
+    const size_t kListed = 20;
+    const size_t kTopPublishers = 5;
+    Bitmap matched = catalogIndex.match(filter);
+
+    std::cout << "Catalog Report: " << matched.cardinality() << " matching books\n";
+    std::cout << "By status:";
+    for (BookStatus status : {BookStatus::Available, BookStatus::Borrowed, BookStatus::Reserved}) {
+        std::cout << " " << toString(status) << " " << (matched & catalogIndex.withStatus(status)).cardinality();
+    }
+    std::cout << "\n";
+
+    std::map<int, size_t> decades;
+    catalogIndex.forEachYear([&matched, &decades](int year, const Bitmap& books) {
+        size_t count = (matched & books).cardinality();
+        if (count > 0) decades[year - ((year % 10) + 10) % 10] += count;
+    });
+    std::cout << "By decade:";
+    for (const auto& decade : decades) std::cout << " " << decade.first << "s " << decade.second;
+    std::cout << "\n";
+
+    std::vector<std::pair<size_t, std::string>> publishers;
+    catalogIndex.forEachPublisher([&matched, &publishers](const std::string& name, const Bitmap& books) {
+        size_t count = (matched & books).cardinality();
+        if (count > 0) publishers.emplace_back(count, name);
+    });
+    size_t shown = std::min(publishers.size(), kTopPublishers);
+    std::partial_sort(publishers.begin(), publishers.begin() + shown, publishers.end(),
+                      [](const std::pair<size_t, std::string>& a, const std::pair<size_t, std::string>& b) {
+                          return a.first != b.first ? a.first > b.first : a.second < b.second;
+                      });
+    std::cout << "Top publishers:";
+    for (size_t i = 0; i < shown; ++i) std::cout << " " << publishers[i].second << " (" << publishers[i].first << ")";
+    std::cout << "\n";
+
+    // Oldest first: each year's books among the matches, in id order
+    PublishedCatalog::Reader catalog = readCatalog();
+    size_t listed = 0;
+    catalogIndex.forEachYear([&catalog, &matched, &listed, kListed](int, const Bitmap& yearBooks) {
+        if (listed == kListed) return;
+        (matched & yearBooks).forEach([&catalog, &listed, kListed](uint32_t bookId) {
+            if (listed == kListed) return false;
+            const BookView* book = catalog.book(static_cast<int>(bookId));
+            if (!book) return true;
+            ++listed;
+            std::cout << "ID: " << book->getBookId()
+                      << ", Title: " << book->getTitle()
+                      << ", Publisher: " << book->getPublisher()
+                      << ", Year: " << book->getYear()
+                      << ", Status: " << book->getStatus() << std::endl;
+            return true;
+        });
+    });
+    if (matched.cardinality() > kListed) {
+        std::cout << "... and " << matched.cardinality() - kListed << " more\n";
+    }
+}
+
+void Library::printMemoryReport(std::ostream& out) const {
+    // A ctime() date string is 24 characters, too long for SSO
+    const size_t dateStringHeap = mallocBlock(25);
+    const size_t legacyRecordSize = sizeof(BorrowRecord) - 2 * sizeof(time_t) + 2 * sizeof(std::string);
+
+    MemoryUsage userUsage, bookUsage, accountUsage;
+    userUsage.poolBytes = pools.students.bytesReserved() + pools.faculty.bytesReserved() +
+                          pools.librarians.bytesReserved();
+    for (const User* user : users) {
+        size_t objectSize = user->getRole() == Role::Student ? sizeof(Student)
+                          : user->getRole() == Role::Faculty ? sizeof(Faculty) : sizeof(Librarian);
+        ++userUsage.live;
+        userUsage.objectBytes += mallocBlock(objectSize);
+        userUsage.heapBytes += stringHeap(user->getUserId()) + stringHeap(user->getName()) +
+                               stringHeap(user->getEmail()) + stringHeap(user->getPassword());
+    }
+
+    bookUsage.poolBytes = pools.books.bytesReserved();
     for (const Book* book : books) {
-        std::cout << "ID: " << book->getBookId()
-                  << ", Title: " << book->getTitle()
-                  << ", Author: " << book->getAuthor()
-                  << ", Status: " << book->getStatus()
-                  << ", Borrowed By: " << book->getBorrowedBy() << std::endl;
+        ++bookUsage.live;
+        bookUsage.objectBytes += mallocBlock(sizeof(Book));
+        bookUsage.heapBytes += stringHeap(book->getTitle()) + stringHeap(book->getAuthor()) +
+                               stringHeap(book->getPublisher()) + stringHeap(book->getIsbn()) +
+                               stringHeap(book->getBorrowedBy());
     }
+
+    accountUsage.poolBytes = pools.accounts.bytesReserved();
+    for (const Account* account : accounts) {
+        const std::vector<BorrowRecord>& history = account->getBorrowHistory();
+        ++accountUsage.live;
+        accountUsage.objectBytes += mallocBlock(sizeof(Account));
+        accountUsage.heapBytes += stringHeap(account->getUserId()) +
+                                  account->getCurrentlyBorrowedBooks().size() * mallocBlock(sizeof(int) + 32);
+        if (history.capacity() > 0) {
+            accountUsage.heapBytes += mallocBlock(history.capacity() * sizeof(BorrowRecord));
+            accountUsage.legacyBytes += mallocBlock(history.capacity() * legacyRecordSize) -
+                                        mallocBlock(history.capacity() * sizeof(BorrowRecord)) +
+                                        history.size() * 2 * dateStringHeap;
+        }
+    }
+
+    out << "Memory report (bytes; 'before' = individual new and string dates, 'after' = pools)\n"
+        << std::left << std::setw(10) << "Entity" << std::right
+        << std::setw(10) << "Live"
+        << std::setw(14) << "Pool"
+        << std::setw(14) << "Owned heap"
+        << std::setw(14) << "Before"
+        << std::setw(14) << "After" << '\n';
+    printMemoryRow(out, "Users", userUsage);
+    printMemoryRow(out, "Books", bookUsage);
+    printMemoryRow(out, "Accounts", accountUsage);
+    out << "sizeof: User " << sizeof(Student) << ", Book " << sizeof(Book)
+        << ", Account " << sizeof(Account) << ", BorrowRecord " << sizeof(BorrowRecord)
+        << " (was " << legacyRecordSize << ")\n";
 }
 
 void Library::displayUserDetails(const std::string& userId) const {
-    User* user = getUser(userId);
-    Account* account = getAccountByUserId(userId);
+    Patron patron = getPatron(userId);
 
-    if (!user || !account) {
+    if (!patron.user || !patron.account) {
         std::cout << "User not found." << std::endl;
         return;
     }
+    User* user = patron.user;
+    Account* account = patron.account;
 
     std::cout << "User Details:" << std::endl;
     std::cout << "ID: " << user->getUserId()
               << ", Name: " << user->getName()
-              << ", Role: " << user->getRole()
+              << ", Role: " << user->getRoleName()
               << ", Email: " << user->getEmail()
               << ", Total Fine: " << account->getTotalFine()
               << ", Fine Paid: " << (account->isFinePaid() ? "Yes" : "No") << std::endl;
@@ -607,18 +1806,19 @@ void Library::displayUserBorrowHistory(const std::string& userId) const {
     std::cout << "Borrow History for User " << userId << ":" << std::endl;
     for (const BorrowRecord& record : account->getBorrowHistory()) {
         std::cout << "Book ID: " << record.bookId
-                  << ", Borrowed: " << record.borrowDate
-                  << ", Due: " << record.dueDate
+                  << ", Borrowed: " << formatDate(record.borrowDate)
+                  << ", Due: " << formatDate(record.dueDate)
                   << ", Returned: " << (record.returned ? "Yes" : "No")
                   << ", Fine: " << record.fine << std::endl;
     }
 }
 
 bool Library::changePassword(const std::string& userId, const std::string& oldPassword, const std::string& newPassword) {
+    MutationScope scope(*this);
     User* user = authenticateUser(userId, oldPassword);
     if (user) {
         user->setPassword(newPassword);
-        saveUsers();
+        markUserDirty(user->getUserId());
         return true;
     }
     return false;
@@ -632,22 +1832,32 @@ bool Library::fileExistsAndHasContent(const std::string& filename) const {
 
 bool Library::updateBook(int bookId, const std::string& title, const std::string& author,
                         const std::string& publisher, int year, const std::string& isbn) {
+    MutationScope scope(*this);
     Book* book = getBook(bookId);
     if (!book) {
         return false;
     }
+    const Book* existing = isbnIndex.find(isbn);
+    if (existing && existing != book) {
+        std::cout << "Error: ISBN " << isbn << " is already used by book ID "
+                  << existing->getBookId() << "." << std::endl;
+        return false;
+    }
 
+    unindexBook(book);
     book->setTitle(title);
     book->setAuthor(author);
     book->setPublisher(publisher);
     book->setYear(year);
     book->setIsbn(isbn);
+    indexBook(book);
     
-    saveBooks();
+    markBookDirty(book->getBookId());
     return true;
 }
 
 bool Library::reserveBook(const std::string& userId, int bookId) {
+    MutationScope scope(*this, userId, bookId);
     User* user = getUser(userId);
     Book* book = getBook(bookId);
     
@@ -665,50 +1875,105 @@ bool Library::reserveBook(const std::string& userId, int bookId) {
         return false;
     }
     
-    if (book->reserve(userId)) {
+    if (applyReserve(userId, book)) {
         std::cout << "Book reserved successfully. You will be notified when it becomes available.\n";
-        saveBooks();
         return true;
     }
     return false;
 }
 
+// Queues the user for the book; false if the book refuses the reservation
+bool Library::applyReserve(const std::string& userId, Book* book) {
+    if (!book->reserve(userId, clock.now())) return false;
+    reservationShard(userId)[userId].insert(book->getBookId());
+    markBookDirty(book->getBookId());
+    return true;
+}
+
 bool Library::cancelReservation(const std::string& userId, int bookId) {
+    MutationScope scope(*this, userId, bookId);
     Book* book = getBook(bookId);
     if (!book) return false;
     
     if (book->cancelReservation(userId)) {
+        unindexReservation(userId, bookId);
+        // If the book was being held for this user, it goes to the next in line
+        offerToNextReservation(book);
         std::cout << "Reservation cancelled successfully.\n";
-        saveBooks();
+        markBookDirty(book->getBookId());
         return true;
     }
     std::cout << "No reservation found for this book.\n";
     return false;
 }
 
+// Lapses the holds that are due, in one pass over only those holds, and
+// offers each book to the next patron in its queue
 void Library::checkAndUpdateReservations() {
-    for (Book* book : books) {
-        if (book->isReservationExpired()) {
-            std::string userId = book->getNextReservation();
-            std::cout << "Reservation expired for user " << userId << " for book: " << book->getTitle() << "\n";
-            book->removeExpiredReservation();
-            saveBooks();
-        }
+    MutationScope scope(*this);
+    time_t now = clock.now();
+    std::vector<Book*> offered;
+    holdExpiries.popDue(now, [this, now, &offered](const HoldExpiry& hold) {
+        Book* book = getBook(hold.bookId);
+        if (!book || book->getNextReservation() != hold.userId || book->getHoldExpiry() != hold.expiry) return;
+
+        std::cout << "Reservation expired for user " << hold.userId << " for book: " << book->getTitle() << "\n";
+        book->removeExpiredReservation(now);
+        unindexReservation(hold.userId, book->getBookId());
+        markBookDirty(book->getBookId());
+        if (offerToNextReservation(book)) offered.push_back(book);
+    });
+    for (const Book* book : offered) {
+        std::cout << "Book '" << book->getTitle() << "' is now held for user " << book->getNextReservation() << "\n";
     }
 }
 
+// Notifies the patron at the head of the queue of an available book that
+// nobody has been notified for yet, and starts their hold
+bool Library::offerToNextReservation(Book* book) {
+    if (!book->isAvailable() || book->getNextReservation().empty() || book->getHoldExpiry() != 0) return false;
+    book->notifyNextInQueue(clock.now(), clock.days(Book::kHoldDays));
+    scheduleHold(book);
+    return true;
+}
+
+void Library::scheduleHold(const Book* book) {
+    time_t expiry = book->getHoldExpiry();
+    if (expiry == 0) return;
+    // A hold has lapsed once the time is past its expiry
+    std::lock_guard<std::mutex> lock(holdMutex);
+    holdExpiries.push(expiry + 1, HoldExpiry{book->getBookId(), book->getNextReservation(), expiry});
+}
+
+// Read from the published catalog, so it waits for no operation
 std::vector<Book*> Library::getReservedBooks(const std::string& userId) const {
     std::vector<Book*> reservedBooks;
-    for (Book* book : books) {
-        if (book->hasReservation(userId)) {
+    for (int bookId : readCatalog().reservedBooks(userId)) {
+        if (Book* book = getBook(bookId)) {
             reservedBooks.push_back(book);
         }
     }
     return reservedBooks;
 }
 
+// Callers hold the user's account stripe or the structure lock exclusively
+void Library::unindexReservation(const std::string& userId, int bookId) {
+    auto& shard = reservationShard(userId);
+    auto it = shard.find(userId);
+    if (it == shard.end()) return;
+    it->second.erase(bookId);
+    if (it->second.empty()) {
+        shard.erase(it);
+    }
+}
+
+std::unordered_map<std::string, std::set<int>>& Library::reservationShard(const std::string& userId) {
+    return reservationsByUser[std::hash<std::string>()(userId) % kLockStripes];
+}
+
 bool Library::isBookReservedForUser(const std::string& userId, int bookId) const {
-    Book* book = getBook(bookId);
+    PublishedCatalog::Reader catalog = readCatalog();
+    const BookView* book = catalog.book(bookId);
     return book && book->hasReservation(userId);
 }
 
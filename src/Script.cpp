@@ -0,0 +1,279 @@
+#include "Script.h"
+#include "FieldParser.h"
+#include <iomanip>
+#include <chrono>
+
+namespace {
+
+const char* const kCommandNames[] = {
+    "borrow", "return", "reserve", "cancel", "pay", "fine", "book", "search",
+    "adduser", "addbook", "removeuser", "removebook", "fines", "holds", "flush", "batch"
+};
+
+// What each command expects, for errors
+const char* const kCommandUsage[] = {
+    "borrow <userId> <bookId>", "return <userId> <bookId>", "reserve <userId> <bookId>",
+    "cancel <userId> <bookId>", "pay <userId> <amount>", "fine <userId>", "book <bookId>",
+    "search <query>", "adduser id|name|email|password|type", "addbook title|author|publisher|year|isbn",
+    "removeuser <userId>", "removebook <bookId>", "fines", "holds", "flush", "batch"
+};
+
+std::string_view trim(std::string_view text) {
+    const char* blanks = " \t\r";
+    size_t start = text.find_first_not_of(blanks);
+    if (start == std::string_view::npos) return std::string_view();
+    return text.substr(start, text.find_last_not_of(blanks) - start + 1);
+}
+
+// Splits on runs of blanks into at most `maxWords` views; returns the real
+// word count
+size_t splitWords(std::string_view text, std::string_view* words, size_t maxWords) {
+    size_t count = 0;
+    size_t pos = 0;
+    while ((pos = text.find_first_not_of(" \t", pos)) != std::string_view::npos) {
+        size_t end = text.find_first_of(" \t", pos);
+        if (end == std::string_view::npos) end = text.size();
+        if (count < maxWords) words[count] = text.substr(pos, end - pos);
+        ++count;
+        pos = end;
+    }
+    return count;
+}
+
+void printBook(std::ostream& out, const BookView& book) {
+    out << "ID: " << book.getBookId()
+        << ", Title: " << book.getTitle()
+        << ", Author: " << book.getAuthor()
+        << ", Publisher: " << book.getPublisher()
+        << ", Status: " << book.getStatus() << "\n";
+}
+
+double secondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+} // namespace
+
+ScriptRunner::ScriptRunner(Library& lib, std::ostream& out)
+    : lib(lib), out(out), lineNumber(0), inBatch(false), batchLine(0) {}
+
+bool ScriptRunner::run(std::istream& in) {
+    bool ok = true;
+    std::string line;
+    while (std::getline(in, line)) {
+        ++lineNumber;
+        if (!execute(line)) ok = false;
+    }
+    if (inBatch) {
+        out << "Error: line " << batchLine << ": batch has no end; not applied\n";
+        inBatch = false;
+        batch.clear();
+        batchLines.clear();
+        ok = false;
+    }
+    return ok;
+}
+
+bool ScriptRunner::execute(std::string_view line) {
+    line = trim(line);
+    if (line.empty() || line.front() == '#') return true;
+    size_t blank = line.find_first_of(" \t");
+    std::string_view word = line.substr(0, blank);
+    std::string_view arguments = blank == std::string_view::npos ? std::string_view() : trim(line.substr(blank));
+
+    if (word == "end") {
+        if (!inBatch) return fail("end without batch");
+        return applyBatch();
+    }
+    int command = 0;
+    while (command < kCommandCount && word != kCommandNames[command]) ++command;
+    if (command == kCommandCount) return fail("unknown command '" + std::string(word) + "'");
+
+    if (inBatch) return queue(static_cast<Command>(command), arguments);
+    if (command == kBatch) {
+        if (!arguments.empty()) return fail("usage: batch");
+        inBatch = true;
+        batchLine = lineNumber;
+        return true;
+    }
+
+    auto started = std::chrono::steady_clock::now();
+    bool ok = dispatch(static_cast<Command>(command), arguments);
+    CommandStats& stat = stats[command];
+    stat.seconds += secondsSince(started);
+    ++stat.count;
+    if (!ok) ++stat.failed;
+    return ok;
+}
+
+bool ScriptRunner::dispatch(Command command, std::string_view arguments) {
+    // Error messages are only built for the lines that need them
+    auto usage = [&] { return fail(std::string("usage: ") + kCommandUsage[command]); };
+    auto failed = [&] { return fail(std::string(kCommandNames[command]) + " " + std::string(arguments) + " failed"); };
+    std::string_view words[2];
+    size_t wordCount = splitWords(arguments, words, 2);
+
+    switch (command) {
+    case kBorrow:
+    case kReturn:
+    case kReserve:
+    case kCancel: {
+        int bookId;
+        if (wordCount != 2 || !parseInt(words[1], bookId)) return usage();
+        std::string userId(words[0]);
+        bool ok = command == kBorrow    ? lib.borrowBook(userId, bookId)
+                  : command == kReturn  ? lib.returnBook(userId, bookId)
+                  : command == kReserve ? lib.reserveBook(userId, bookId)
+                                        : lib.cancelReservation(userId, bookId);
+        return ok || failed();
+    }
+    case kPay:
+    case kFine: {
+        double amount = 0;
+        if (wordCount != (command == kPay ? 2u : 1u)) return usage();
+        if (command == kPay && (!parseDouble(words[1], amount) || amount <= 0)) return usage();
+        std::string userId(words[0]);
+        Account* account = lib.getAccount(userId);
+        if (!account) return fail("no account for " + userId);
+        if (command == kFine) {
+            out << "Fine for " << userId << ": Rs. " << account->getTotalFine() << "\n";
+            return true;
+        }
+        if (account->getTotalFine() <= 0) return fail(userId + " has no fines to pay");
+        lib.payFine(userId, amount);
+        return true;
+    }
+    case kBook: {
+        int bookId;
+        if (wordCount != 1 || !parseInt(words[0], bookId)) return usage();
+        PublishedCatalog::Reader catalog = lib.readCatalog();
+        const BookView* book = catalog.book(bookId);
+        if (!book) return fail("no book " + std::to_string(bookId));
+        printBook(out, *book);
+        return true;
+    }
+    case kSearch: {
+        if (arguments.empty()) return usage();
+        std::string suggestion;
+        std::vector<Book*> results = lib.findBooks(std::string(arguments), suggestion);
+        if (!results.empty() && !suggestion.empty()) {
+            out << "Did you mean: " << suggestion << "?\n";
+        }
+        if (results.empty()) {
+            out << "No matching books found.\n";
+            return true;
+        }
+        PublishedCatalog::Reader catalog = lib.readCatalog();
+        out << "Search Results:\n";
+        for (const Book* result : results) {
+            if (const BookView* book = catalog.book(result->getBookId())) printBook(out, *book);
+        }
+        return true;
+    }
+    case kAddUser: {
+        std::string_view fields[5];
+        if (splitFields(arguments, fields, 5) != 5) return usage();
+        std::string userId(fields[0]);
+        if (lib.getUser(userId)) return fail("user " + userId + " already exists");
+        User* user = lib.addUser(std::string(fields[1]), std::string(fields[2]), std::string(fields[3]),
+                                 std::string(fields[4]), userId);
+        if (!user) return failed();
+        lib.createAccount(user);
+        return true;
+    }
+    case kAddBook: {
+        std::string_view fields[5];
+        int year;
+        if (splitFields(arguments, fields, 5) != 5 || !parseInt(fields[3], year)) return usage();
+        return lib.addBook(std::string(fields[0]), std::string(fields[1]), std::string(fields[2]), year,
+                           std::string(fields[4])) || failed();
+    }
+    case kRemoveUser:
+        if (wordCount != 1) return usage();
+        return lib.removeUser(std::string(words[0])) || failed();
+    case kRemoveBook: {
+        int bookId;
+        if (wordCount != 1 || !parseInt(words[0], bookId)) return usage();
+        return lib.removeBook(bookId) || failed();
+    }
+    case kFines:
+    case kHolds:
+    case kFlush:
+        if (wordCount != 0) return usage();
+        if (command == kFines) lib.updateFines();
+        else if (command == kHolds) lib.checkAndUpdateReservations();
+        else if (!lib.flush()) return failed();
+        return true;
+    default:
+        return usage();
+    }
+}
+
+// Adds a line inside batch ... end to the open batch
+bool ScriptRunner::queue(Command command, std::string_view arguments) {
+    CirculationRequest request;
+    switch (command) {
+    case kBorrow: request.action = CirculationRequest::Action::Borrow; break;
+    case kReturn: request.action = CirculationRequest::Action::Return; break;
+    case kReserve: request.action = CirculationRequest::Action::Reserve; break;
+    default: return fail("only borrow, return and reserve can be batched");
+    }
+    std::string_view words[2];
+    if (splitWords(arguments, words, 2) != 2 || !parseInt(words[1], request.bookId)) {
+        return fail(std::string("usage: ") + kCommandUsage[command]);
+    }
+    request.userId = std::string(words[0]);
+    batch.push_back(std::move(request));
+    batchLines.push_back(lineNumber);
+    return true;
+}
+
+bool ScriptRunner::applyBatch() {
+    inBatch = false;
+    std::vector<CirculationResult> results;
+    auto started = std::chrono::steady_clock::now();
+    bool applied = lib.applyBatch(batch, results);
+    CommandStats& stat = stats[kBatch];
+    stat.seconds += secondsSince(started);
+    stat.count += batch.size();
+
+    if (!applied) {
+        stat.failed += batch.size();
+        for (size_t i = 0; i < results.size(); ++i) {
+            if (results[i].outcome == CirculationResult::Outcome::Refused) {
+                out << "Error: line " << batchLines[i] << ": " << results[i].reason << "\n";
+            }
+        }
+        out << "Error: line " << batchLine << ": batch of " << batch.size() << " not applied\n";
+    }
+    batch.clear();
+    batchLines.clear();
+    return applied;
+}
+
+bool ScriptRunner::fail(std::string_view message) {
+    out << "Error: line " << lineNumber << ": " << message << "\n";
+    return false;
+}
+
+void ScriptRunner::report(std::ostream& out, double wallSeconds) const {
+    size_t total = 0;
+    size_t failed = 0;
+    for (const CommandStats& stat : stats) {
+        total += stat.count;
+        failed += stat.failed;
+    }
+    out << std::fixed << std::setprecision(2) << "Script: " << total << " commands in " << wallSeconds << " s, "
+        << std::setprecision(0) << (wallSeconds > 0 ? total / wallSeconds : 0.0) << " commands/s, " << failed
+        << " failed\n";
+    out << std::left << std::setw(12) << "Command" << std::right << std::setw(10) << "Count" << std::setw(10)
+        << "Failed" << std::setw(12) << "Mean us" << std::setw(14) << "Commands/s" << "\n";
+    for (int command = 0; command < kCommandCount; ++command) {
+        const CommandStats& stat = stats[command];
+        if (stat.count == 0) continue;
+        out << std::left << std::setw(12) << kCommandNames[command] << std::right << std::setw(10) << stat.count
+            << std::setw(10) << stat.failed << std::setw(12) << std::setprecision(1)
+            << stat.seconds * 1e6 / stat.count << std::setw(14) << std::setprecision(0)
+            << (stat.seconds > 0 ? stat.count / stat.seconds : 0.0) << "\n";
+    }
+}
@@ -0,0 +1,420 @@
+#include "Simulator.h"
+#include "Library.h"
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+#include <chrono>
+#include <thread>
+#include <sstream>
+#include <filesystem>
+#include <system_error>
+#include <cstdlib>
+
+namespace {
+
+// Fixed start of the simulated semester, so runs with a seed are repeatable
+const time_t kSemesterStart = 1700000000;
+
+const char* const kOperationNames[] = {
+    "borrowBook", "returnBook", "reserveBook", "payFine", "calculateFines", "checkAndUpdateReservations",
+};
+
+// A new, empty directory under the system's temporary directory for the
+// scratch databases of one run, removed with its contents afterwards; no
+// directory that existed before is touched
+class ScratchDirectory {
+private:
+    std::string path;
+
+public:
+    ScratchDirectory() {
+        std::error_code error;
+        std::filesystem::path base = std::filesystem::temp_directory_path(error);
+        if (error) return;
+        std::string pattern = (base / "lms-simulation-XXXXXX").string();
+        if (mkdtemp(&pattern[0])) path = pattern;
+    }
+
+    ~ScratchDirectory() {
+        if (path.empty()) return;
+        std::error_code error;
+        std::filesystem::remove_all(path, error);
+        if (error) std::cerr << "Error: Cannot remove " << path << ": " << error.message() << std::endl;
+    }
+
+    ScratchDirectory(const ScratchDirectory&) = delete;
+    ScratchDirectory& operator=(const ScratchDirectory&) = delete;
+
+    bool created() const { return !path.empty(); }
+    const std::string& getPath() const { return path; }
+};
+
+// Accepts and drops every character, keeping no state of its own
+class NullBuffer : public std::streambuf {
+protected:
+    int overflow(int c) override { return c == EOF ? 0 : c; }
+};
+
+// Discards everything written to std::cout while in scope; the library
+// reports to the console on every operation
+class QuietOutput {
+private:
+    NullBuffer discard;
+    std::streambuf* saved;
+
+public:
+    QuietOutput() : saved(std::cout.rdbuf(&discard)) {}
+    ~QuietOutput() { std::cout.rdbuf(saved); }
+};
+
+double percentile(const std::vector<double>& sorted, double fraction) {
+    if (sorted.empty()) return 0.0;
+    size_t index = std::min(sorted.size() - 1, static_cast<size_t>(fraction * sorted.size()));
+    return sorted[index];
+}
+
+} // namespace
+
+Simulator::Simulator(const SimulationConfig& config)
+    : config(config), clock(kSemesterStart, 24 * 60 * 60), rng(config.seed) {}
+
+void Simulator::run(std::ostream& out) {
+    if (!config.threadCounts.empty()) {
+        runConcurrent(out);
+        return;
+    }
+
+    ScratchDirectory scratch;
+    if (!scratch.created()) {
+        std::cerr << "Error: Cannot create a scratch directory for the simulation" << std::endl;
+        return;
+    }
+
+    double wallSeconds = 0.0;
+    size_t eventCount = 0;
+    {
+        QuietOutput quiet;
+        Library lib(scratch.getPath() + "/data", clock);
+        populate(lib);
+        for (int patron = 0; patron < static_cast<int>(patrons.size()); ++patron) {
+            events.push(clock.now() + randomDelay(1.0 / config.visitsPerDay), Event{EventType::Visit, patron, 0});
+        }
+        events.push(clock.now() + clock.days(1), Event{EventType::DailySweep, 0, 0});
+
+        time_t end = kSemesterStart + clock.days(config.days);
+        auto started = std::chrono::steady_clock::now();
+        while (!events.empty() && events.nextDue() <= end) {
+            clock.set(events.nextDue());
+            eventCount += events.popDue(clock.now(), [this, &lib](const Event& event) { handle(lib, event); });
+        }
+        wallSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+    }
+
+    report(out, wallSeconds, eventCount);
+}
+
+// Adds the simulated books and patrons
+void Simulator::populate(Library& lib) {
+    // Setup is not measured, so it need not be durable record by record
+    lib.setCommitPolicy(CommitPolicy::EveryNOperations, static_cast<size_t>(config.books + config.students + config.faculty));
+    for (int i = 0; i < config.books; ++i) {
+        Book* book = lib.addBook("Simulated Book " + std::to_string(i), "Author " + std::to_string(i % 500),
+                                 "Publisher " + std::to_string(i % 50), 1950 + i % 70,
+                                 std::to_string(9790000000000LL + i));
+        if (book) bookIds.push_back(book->getBookId());
+    }
+    for (int i = 0; i < config.students + config.faculty; ++i) {
+        bool student = i < config.students;
+        std::string id = (student ? "SIM-S" : "SIM-F") + std::to_string(i);
+        User* user = lib.addUser("Patron " + std::to_string(i), id + "@example.edu", "password",
+                                 student ? "Student" : "Faculty", id);
+        if (!user) continue;
+        lib.createAccount(user);
+        patrons.push_back(id);
+    }
+    lib.setCommitPolicy(CommitPolicy::Immediate);
+}
+
+void Simulator::handle(Library& lib, const Event& event) {
+    switch (event.type) {
+        case EventType::Visit:
+            visit(lib, event.patron);
+            events.push(clock.now() + randomDelay(1.0 / config.visitsPerDay), event);
+            break;
+        case EventType::Return:
+            timed(kReturn, [&] { return lib.returnBook(patrons[event.patron], event.bookId); });
+            break;
+        case EventType::DailySweep:
+            // What the menu loop runs before each screen
+            timed(kFineSweep, [&] { lib.calculateFines(); return true; });
+            timed(kHoldSweep, [&] { lib.checkAndUpdateReservations(); return true; });
+            events.push(clock.now() + clock.days(1), event);
+            break;
+    }
+}
+
+// One trip to the library: maybe settle fines, pick up any held books,
+// then try to borrow a book, reserving it if it is out
+void Simulator::visit(Library& lib, int patron) {
+    const std::string& userId = patrons[patron];
+    const Account* account = lib.getAccount(userId);
+    if (!account || bookIds.empty()) return;
+
+    if (account->getTotalFine() > 0 && rng() % 2 == 0) {
+        double fine = account->getTotalFine();
+        timed(kPayFine, [&] { lib.payFine(userId, fine); return true; });
+    }
+
+    for (const Book* book : lib.getReservedBooks(userId)) {
+        if (book->isAvailable() && book->getNextReservation() == userId) {
+            borrow(lib, patron, book->getBookId());
+        }
+    }
+
+    int bookId = pickBook(rng);
+    const Book* book = lib.getBook(bookId);
+    if (!book) return;
+    if (book->isAvailable()) {
+        borrow(lib, patron, bookId);
+    } else if (book->getBorrowedBy() != userId && !book->hasReservation(userId)) {
+        timed(kReserve, [&] { return lib.reserveBook(userId, bookId); });
+    }
+}
+
+// Borrows a book and schedules its return, which is late about a third of
+// the time
+bool Simulator::borrow(Library& lib, int patron, int bookId) {
+    const std::string& userId = patrons[patron];
+    if (!timed(kBorrow, [&] { return lib.borrowBook(userId, bookId); })) return false;
+    const User* user = lib.getUser(userId);
+    double loanDays = user ? user->getPolicy().loanDays : 15;
+    events.push(clock.now() + randomDelay(loanDays * 0.8), Event{EventType::Return, patron, bookId});
+    return true;
+}
+
+// A few titles are much more popular than the rest, so queues form
+int Simulator::pickBook(std::mt19937& random) const {
+    double u = std::uniform_real_distribution<double>(0.0, 1.0)(random);
+    size_t index = std::min(bookIds.size() - 1, static_cast<size_t>(u * u * u * bookIds.size()));
+    return bookIds[index];
+}
+
+// Exponentially distributed delay with the given mean, at least a second
+time_t Simulator::randomDelay(double meanDays) {
+    double days = std::exponential_distribution<double>(1.0 / meanDays)(rng);
+    return std::max<time_t>(1, static_cast<time_t>(days * clock.secondsPerDay()));
+}
+
+template <typename F>
+bool Simulator::timed(Operation operation, F f) {
+    auto started = std::chrono::steady_clock::now();
+    bool ok = f();
+    std::chrono::duration<double, std::micro> elapsed = std::chrono::steady_clock::now() - started;
+    stats[operation].micros.push_back(elapsed.count());
+    if (ok) ++stats[operation].succeeded;
+    return ok;
+}
+
+void Simulator::report(std::ostream& out, double wallSeconds, size_t eventCount) const {
+    double virtualSeconds = static_cast<double>(clock.days(config.days));
+    out << "Simulated " << config.days << " days with " << config.students << " students, "
+        << config.faculty << " faculty and " << config.books << " books (seed " << config.seed << ")\n"
+        << eventCount << " events in " << std::fixed << std::setprecision(2) << wallSeconds << " s of wall time ("
+        << std::setprecision(0) << (wallSeconds > 0 ? virtualSeconds / wallSeconds : 0.0) << "x real time)\n"
+        << std::left << std::setw(28) << "Operation" << std::right
+        << std::setw(9) << "Calls"
+        << std::setw(9) << "OK"
+        << std::setw(11) << "Ops/s"
+        << std::setw(10) << "p50 us"
+        << std::setw(10) << "p95 us"
+        << std::setw(10) << "p99 us"
+        << std::setw(10) << "Max us" << '\n';
+    for (int operation = 0; operation < kOperationCount; ++operation) {
+        std::vector<double> sorted = stats[operation].micros;
+        std::sort(sorted.begin(), sorted.end());
+        double busySeconds = 0.0;
+        for (double micros : sorted) busySeconds += micros / 1e6;
+        out << std::left << std::setw(28) << kOperationNames[operation] << std::right
+            << std::setw(9) << sorted.size()
+            << std::setw(9) << stats[operation].succeeded
+            << std::setw(11) << std::setprecision(0) << (busySeconds > 0 ? sorted.size() / busySeconds : 0.0)
+            << std::setprecision(1)
+            << std::setw(10) << percentile(sorted, 0.50)
+            << std::setw(10) << percentile(sorted, 0.95)
+            << std::setw(10) << percentile(sorted, 0.99)
+            << std::setw(10) << (sorted.empty() ? 0.0 : sorted.back()) << '\n';
+    }
+    out << std::defaultfloat;
+}
+
+void Simulator::runConcurrent(std::ostream& out) {
+    out << "Concurrent circulation: " << config.operations << " operations per run, "
+        << config.students + config.faculty << " patrons, " << config.books << " books\n"
+        << std::left << std::setw(9) << "Threads" << std::right
+        << std::setw(10) << "Seconds"
+        << std::setw(12) << "Ops/s"
+        << std::setw(10) << "Speedup" << "  Check\n";
+
+    double baseline = 0.0;
+    for (int workers : config.threadCounts) {
+        ScratchDirectory scratch;
+        if (!scratch.created()) {
+            std::cerr << "Error: Cannot create a scratch directory for the simulation" << std::endl;
+            return;
+        }
+        std::string dataDir = scratch.getPath() + "/data";
+        std::string copyDir = scratch.getPath() + "/copy";
+        patrons.clear();
+        bookIds.clear();
+        clock.set(kSemesterStart);
+
+        int perWorker = config.operations / workers;
+        double seconds = 0.0;
+        std::string problem;
+        {
+            QuietOutput quiet;
+            Library lib(dataDir, clock);
+            populate(lib);
+            std::vector<std::set<int>> loans(patrons.size());
+
+            auto started = std::chrono::steady_clock::now();
+            std::vector<std::thread> threads;
+            for (int worker = 0; worker < workers; ++worker) {
+                threads.emplace_back([this, &lib, worker, workers, perWorker, &loans] {
+                    work(lib, worker, workers, perWorker, loans);
+                });
+            }
+            for (std::thread& thread : threads) thread.join();
+            seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+
+            problem = verify(lib, loans);
+            if (problem.empty()) {
+                // The data files and journal alone must rebuild the same state
+                if (!lib.flush()) {
+                    problem = "the journal could not be committed";
+                } else {
+                    std::error_code error;
+                    std::filesystem::copy(dataDir, copyDir, std::filesystem::copy_options::recursive, error);
+                    if (error) {
+                        problem = "cannot copy the database: " + error.message();
+                    } else {
+                        Library reloaded(copyDir, clock);
+                        if (state(reloaded) != state(lib)) problem = "state reloaded from the journal differs";
+                    }
+                }
+            }
+        }
+
+        double throughput = seconds > 0 ? perWorker * workers / seconds : 0.0;
+        if (baseline == 0.0) baseline = throughput;
+        out << std::left << std::setw(9) << workers << std::right << std::fixed
+            << std::setw(10) << std::setprecision(2) << seconds
+            << std::setw(12) << std::setprecision(0) << throughput
+            << std::setw(10) << std::setprecision(2) << (baseline > 0 ? throughput / baseline : 0.0)
+            << "  " << (problem.empty() ? "ok" : problem) << '\n';
+    }
+    out << std::defaultfloat;
+}
+
+// One worker's share of the concurrent run. Each worker serves its own
+// patrons, so it knows exactly which books they hold; the books are shared.
+// Worker 0 also moves the clock a day ahead every 1000 operations and runs
+// the sweeps the menu would.
+void Simulator::work(Library& lib, int worker, int workers, int operations, std::vector<std::set<int>>& loans) {
+    std::mt19937 random(config.seed * 7919 + static_cast<unsigned>(worker));
+    std::vector<int> mine;
+    for (int patron = worker; patron < static_cast<int>(patrons.size()); patron += workers) mine.push_back(patron);
+    if (mine.empty() || bookIds.empty()) return;
+
+    for (int i = 0; i < operations; ++i) {
+        if (worker == 0 && i % 1000 == 999) {
+            clock.advance(clock.days(1));
+            lib.calculateFines();
+            lib.checkAndUpdateReservations();
+        }
+        int patron = mine[random() % mine.size()];
+        const std::string& userId = patrons[patron];
+        std::set<int>& held = loans[patron];
+        unsigned roll = random() % 100;
+        if (roll < 40 || (roll < 75 && held.empty())) {
+            int bookId = pickBook(random);
+            if (lib.borrowBook(userId, bookId)) held.insert(bookId);
+        } else if (roll < 75) {
+            auto it = std::next(held.begin(), static_cast<long>(random() % held.size()));
+            if (lib.returnBook(userId, *it)) held.erase(it);
+        } else if (roll < 95) {
+            lib.reserveBook(userId, pickBook(random));
+        } else {
+            lib.payFine(userId, 5.0);
+        }
+    }
+}
+
+// Cross-checks books, accounts, reservations, the status index and the
+// published catalog after a concurrent run; returns a description of the first problem, or ""
+std::string Simulator::verify(const Library& lib, const std::vector<std::set<int>>& loans) const {
+    size_t borrowed = 0;
+    size_t queued = 0;
+    PublishedCatalog::Reader catalog = lib.readCatalog();
+    std::vector<Book*> books = lib.getAllBooks();
+    if (catalog.size() != books.size()) return "published catalog has a different number of books";
+    for (const Book* book : books) {
+        std::string id = std::to_string(book->getBookId());
+        const BookView* view = catalog.book(book->getBookId());
+        if (!view || view->getStatusCode() != book->getStatusCode() || view->getBorrowedBy() != book->getBorrowedBy() ||
+            view->getReservedUserIds() != book->getReservedUserIds()) {
+            return "published catalog differs for book " + id;
+        }
+        if (book->getStatusCode() == BookStatus::Borrowed) {
+            ++borrowed;
+            const Account* account = lib.getAccount(book->getBorrowedBy());
+            if (!account || !account->getCurrentlyBorrowedBooks().count(book->getBookId())) {
+                return "book " + id + " is out to a patron who does not hold it";
+            }
+        } else if (!book->getBorrowedBy().empty()) {
+            return "book " + id + " is available but has a borrower";
+        }
+        queued += book->getReservationCount();
+    }
+
+    size_t held = 0;
+    size_t reserved = 0;
+    for (size_t patron = 0; patron < patrons.size(); ++patron) {
+        const Account* account = lib.getAccount(patrons[patron]);
+        if (!account || account->getCurrentlyBorrowedBooks() != loans[patron]) {
+            return "loans of " + patrons[patron] + " differ from what the worker borrowed";
+        }
+        held += loans[patron].size();
+        for (const Book* book : lib.getReservedBooks(patrons[patron])) {
+            if (!book->hasReservation(patrons[patron])) {
+                return "reservation index lists book " + std::to_string(book->getBookId()) + " for " + patrons[patron];
+            }
+            ++reserved;
+        }
+    }
+    if (held != borrowed) return "books out and loans held differ";
+    if (reserved != queued) return "reservation queues and index differ";
+
+    BookFilter filter;
+    filter.anyStatus = false;
+    filter.status = BookStatus::Borrowed;
+    if (lib.countBooks(filter) != borrowed) return "status index is out of step";
+    return "";
+}
+
+// What the data files keep of books and accounts, for comparing a reload
+std::string Simulator::state(const Library& lib) const {
+    std::ostringstream out;
+    out << std::fixed << std::setprecision(2);
+    for (const Book* book : lib.getAllBooks()) {
+        out << book->getBookId() << ' ' << book->getStatus() << ' ' << book->getBorrowedBy() << '\n';
+    }
+    for (const std::string& userId : patrons) {
+        const Account* account = lib.getAccount(userId);
+        if (!account) continue;
+        out << userId << ' ' << account->getTotalFine() << ' ' << account->isFinePaid();
+        for (int bookId : account->getCurrentlyBorrowedBooks()) out << ' ' << bookId;
+        out << '\n';
+    }
+    return out.str();
+}
@@ -0,0 +1,181 @@
+#include "Snapshot.h"
+#include <algorithm>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+namespace snapshot {
+
+namespace {
+
+uint64_t alignUp(uint64_t offset) {
+    return (offset + 7) & ~uint64_t(7);
+}
+
+bool sectionFits(uint64_t offset, uint64_t count, size_t recordSize, size_t fileSize) {
+    return offset <= fileSize && count <= (fileSize - offset) / recordSize;
+}
+
+// Accumulates strings into the heap section
+class HeapBuilder {
+private:
+    std::string heap;
+
+public:
+    StrRef add(const std::string& s) {
+        StrRef ref{static_cast<uint32_t>(heap.size()), static_cast<uint32_t>(s.size())};
+        heap += s;
+        return ref;
+    }
+    const std::string& data() const { return heap; }
+};
+
+// Zero-fills up to `offset`, where the next section starts
+void padTo(DurableFile& out, uint64_t offset) {
+    static const char zeros[8] = {};
+    uint64_t at = out.size();
+    if (at < offset) out.write(std::string_view(zeros, std::min<uint64_t>(sizeof(zeros), offset - at)));
+}
+
+template <typename T>
+void writeSection(DurableFile& out, const std::vector<T>& records, uint64_t offset) {
+    padTo(out, offset);
+    out.write(std::string_view(reinterpret_cast<const char*>(records.data()), records.size() * sizeof(T)));
+}
+
+} // namespace
+
+Reader::Reader() : base(nullptr), size(0), header(nullptr) {}
+
+Reader::~Reader() {
+    close();
+}
+
+bool Reader::open(const std::string& path) {
+    close();
+
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+
+    struct stat st;
+    if (::fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < sizeof(Header)) {
+        ::close(fd);
+        return false;
+    }
+
+    void* mapped = ::mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (mapped == MAP_FAILED) return false;
+
+    base = static_cast<const char*>(mapped);
+    size = static_cast<size_t>(st.st_size);
+    header = reinterpret_cast<const Header*>(base);
+
+    bool valid = std::memcmp(header->magic, kMagic, sizeof(kMagic)) == 0 &&
+                 header->version == kVersion &&
+                 sectionFits(header->usersOffset, header->userCount, sizeof(UserRecord), size) &&
+                 sectionFits(header->booksOffset, header->bookCount, sizeof(BookRecord), size) &&
+                 sectionFits(header->accountsOffset, header->accountCount, sizeof(AccountRecord), size) &&
+                 sectionFits(header->loansOffset, header->loanCount, sizeof(int32_t), size) &&
+                 sectionFits(header->heapOffset, header->heapSize, 1, size);
+    if (valid) {
+        for (size_t i = 0; i < header->accountCount; ++i) {
+            const AccountRecord& rec = account(i);
+            if (static_cast<uint64_t>(rec.firstLoan) + rec.loanCount > header->loanCount) {
+                valid = false;
+                break;
+            }
+        }
+    }
+    if (!valid) {
+        close();
+        return false;
+    }
+    return true;
+}
+
+void Reader::close() {
+    if (base) {
+        ::munmap(const_cast<char*>(base), size);
+    }
+    base = nullptr;
+    size = 0;
+    header = nullptr;
+}
+
+bool write(const std::string& path, const Checkpoint& checkpoint, const std::vector<User*>& users,
+           const BookStore& books, const std::vector<Account*>& accounts) {
+    HeapBuilder heap;
+    std::vector<UserRecord> userRecords;
+    std::vector<BookRecord> bookRecords;
+    std::vector<AccountRecord> accountRecords;
+    std::vector<int32_t> loans;
+
+    userRecords.reserve(users.size());
+    for (const User* user : users) {
+        UserRecord rec{};
+        rec.id = heap.add(user->getUserId());
+        rec.name = heap.add(user->getName());
+        rec.email = heap.add(user->getEmail());
+        rec.password = heap.add(user->getPassword());
+        rec.role = static_cast<uint8_t>(user->getRole());
+        userRecords.push_back(rec);
+    }
+
+    bookRecords.reserve(books.size());
+    for (const Book* book : books) {
+        BookRecord rec{};
+        rec.id = book->getBookId();
+        rec.year = book->getYear();
+        rec.title = heap.add(book->getTitle());
+        rec.author = heap.add(book->getAuthor());
+        rec.publisher = heap.add(book->getPublisher());
+        rec.isbn = heap.add(book->getIsbn());
+        rec.borrowedBy = heap.add(book->getBorrowedBy());
+        rec.status = static_cast<uint8_t>(book->getStatusCode());
+        bookRecords.push_back(rec);
+    }
+
+    accountRecords.reserve(accounts.size());
+    for (const Account* account : accounts) {
+        AccountRecord rec{};
+        rec.userId = heap.add(account->getUserId());
+        rec.totalFine = account->getTotalFine();
+        rec.firstLoan = static_cast<uint32_t>(loans.size());
+        rec.loanCount = static_cast<uint32_t>(account->getCurrentlyBorrowedBooks().size());
+        rec.finePaid = account->isFinePaid() ? 1 : 0;
+        for (int bookId : account->getCurrentlyBorrowedBooks()) {
+            loans.push_back(bookId);
+        }
+        accountRecords.push_back(rec);
+    }
+
+    Header header{};
+    std::memcpy(header.magic, kMagic, sizeof(kMagic));
+    header.version = kVersion;
+    header.checkpoint = checkpoint;
+    header.userCount = userRecords.size();
+    header.bookCount = bookRecords.size();
+    header.accountCount = accountRecords.size();
+    header.loanCount = loans.size();
+    header.heapSize = heap.data().size();
+    header.usersOffset = alignUp(sizeof(Header));
+    header.booksOffset = alignUp(header.usersOffset + userRecords.size() * sizeof(UserRecord));
+    header.accountsOffset = alignUp(header.booksOffset + bookRecords.size() * sizeof(BookRecord));
+    header.loansOffset = alignUp(header.accountsOffset + accountRecords.size() * sizeof(AccountRecord));
+    header.heapOffset = alignUp(header.loansOffset + loans.size() * sizeof(int32_t));
+
+    DurableFile out(path);
+    out.write(std::string_view(reinterpret_cast<const char*>(&header), sizeof(header)));
+    writeSection(out, userRecords, header.usersOffset);
+    writeSection(out, bookRecords, header.booksOffset);
+    writeSection(out, accountRecords, header.accountsOffset);
+    writeSection(out, loans, header.loansOffset);
+    padTo(out, header.heapOffset);
+    out.write(heap.data());
+    return out.commit();
+}
+
+} // namespace snapshot
@@ -0,0 +1,320 @@
+#include "Protocol.h"
+#include "FieldParser.h"
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <map>
+#include <thread>
+#include <random>
+#include <chrono>
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace {
+
+// A blocking connection to lms-server that reads replies line by line
+class Connection {
+private:
+    int fd;
+    std::string received;
+
+public:
+    Connection() : fd(-1) {}
+    ~Connection() {
+        if (fd >= 0) close(fd);
+    }
+    Connection(const Connection&) = delete;
+    Connection& operator=(const Connection&) = delete;
+
+    bool open(const std::string& path) {
+        sockaddr_un address;
+        std::memset(&address, 0, sizeof(address));
+        address.sun_family = AF_UNIX;
+        if (path.size() >= sizeof(address.sun_path)) return false;
+        std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+        fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (fd < 0) return false;
+        return connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) == 0;
+    }
+
+    bool sendLine(const std::string& line) {
+        std::string message = line + "\n";
+        size_t sent = 0;
+        while (sent < message.size()) {
+            ssize_t n = send(fd, message.data() + sent, message.size() - sent, MSG_NOSIGNAL);
+            if (n < 0 && errno == EINTR) continue;
+            if (n <= 0) return false;
+            sent += static_cast<size_t>(n);
+        }
+        return true;
+    }
+
+    bool readLine(std::string& line) {
+        size_t end;
+        while ((end = received.find('\n')) == std::string::npos) {
+            char buffer[16384];
+            ssize_t n = recv(fd, buffer, sizeof(buffer), 0);
+            if (n < 0 && errno == EINTR) continue;
+            if (n <= 0) return false;
+            received.append(buffer, static_cast<size_t>(n));
+        }
+        line.assign(received, 0, end);
+        received.erase(0, end + 1);
+        return true;
+    }
+
+    // Reads a whole reply: one line, or "OK n" and n more for SEARCH
+    bool readReply(const std::string& command, std::vector<std::string>& lines) {
+        lines.clear();
+        std::string line;
+        if (!readLine(line)) return false;
+        lines.push_back(line);
+        int extra = 0;
+        if (command == "SEARCH" && line.compare(0, 3, "OK ") == 0 &&
+            parseInt(std::string_view(line).substr(3), extra)) {
+            for (int i = 0; i < extra; ++i) {
+                if (!readLine(line)) return false;
+                lines.push_back(line);
+            }
+        }
+        return true;
+    }
+};
+
+std::string commandOf(const std::string& request) {
+    std::string_view command, argument;
+    splitRequest(request, command, argument);
+    return std::string(command);
+}
+
+// Sends each line of standard input and prints the reply
+int interactive(const std::string& socketPath) {
+    Connection connection;
+    if (!connection.open(socketPath)) {
+        std::cerr << "Error: Cannot connect to " << socketPath << ": " << std::strerror(errno) << std::endl;
+        return 1;
+    }
+    std::string request;
+    std::vector<std::string> reply;
+    while (std::getline(std::cin, request)) {
+        if (request.empty()) continue;
+        std::string command = commandOf(request);
+        if (!connection.sendLine(request) || !connection.readReply(command, reply)) {
+            std::cerr << "Error: Connection closed by server" << std::endl;
+            return 1;
+        }
+        for (const std::string& line : reply) std::cout << line << "\n";
+        std::cout.flush();
+        if (command == "QUIT") break;
+    }
+    return 0;
+}
+
+struct LoadOptions {
+    std::string socketPath;
+    int connections = 4;
+    int requests = 10000;  // per connection
+    std::vector<std::pair<std::string, std::string>> users;
+    unsigned seed = 1;
+};
+
+// Latencies in microseconds, by command
+struct LoadResult {
+    std::map<std::string, std::vector<double>> latencies;
+    std::map<std::string, size_t> succeeded;
+    bool failed = false;
+};
+
+// One closed-loop client: a lookup, a search or a loan change, then wait
+// for the reply before sending the next
+void runClient(const LoadOptions& options, int index, LoadResult& result) {
+    Connection connection;
+    std::vector<std::string> reply;
+    const auto& user = options.users[index % options.users.size()];
+    if (!connection.open(options.socketPath) || !connection.sendLine("AUTH " + user.first + " " + user.second) ||
+        !connection.readReply("AUTH", reply) || reply[0].compare(0, 2, "OK") != 0 ||
+        !connection.sendLine("INFO") || !connection.readReply("INFO", reply)) {
+        result.failed = true;
+        return;
+    }
+    int bookCount = 0;
+    std::string_view info(reply[0]);
+    info.remove_prefix(std::min<size_t>(3, info.size()));
+    parseInt(info.substr(0, info.find(' ')), bookCount);
+    if (bookCount <= 0) bookCount = 1;
+
+    std::mt19937 rng(options.seed * 7919 + static_cast<unsigned>(index));
+    std::uniform_int_distribution<int> anyBook(1, bookCount);
+    std::uniform_int_distribution<int> percent(0, 99);
+    std::vector<std::string> words = {"the"};  // learned from the titles BOOK returns
+    std::vector<int> onLoan;
+
+    for (int i = 0; i < options.requests; ++i) {
+        int roll = percent(rng);
+        std::string request;
+        if (roll < 40) {
+            request = "BOOK " + std::to_string(anyBook(rng));
+        } else if (roll < 60) {
+            request = "SEARCH " + words[rng() % words.size()];
+        } else if (!onLoan.empty() && (onLoan.size() >= 3 || roll < 80)) {
+            request = "RETURN " + std::to_string(onLoan.back());
+        } else {
+            request = "BORROW " + std::to_string(anyBook(rng));
+        }
+        std::string command = commandOf(request);
+
+        auto start = std::chrono::steady_clock::now();
+        if (!connection.sendLine(request) || !connection.readReply(command, reply)) {
+            result.failed = true;
+            return;
+        }
+        double micros = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+        result.latencies[command].push_back(micros);
+
+        bool ok = reply[0].compare(0, 2, "OK") == 0;
+        if (!ok) continue;
+        ++result.succeeded[command];
+        if (command == "BORROW") {
+            int bookId = 0;
+            parseInt(std::string_view(request).substr(7), bookId);
+            onLoan.push_back(bookId);
+        } else if (command == "RETURN") {
+            onLoan.pop_back();
+        } else if (command == "BOOK" && words.size() < 256) {
+            // id|title|...: keep the first long word of the title
+            size_t titleStart = reply[0].find('|');
+            size_t titleEnd = reply[0].find('|', titleStart + 1);
+            if (titleStart == std::string::npos || titleEnd == std::string::npos) continue;
+            std::string title = reply[0].substr(titleStart + 1, titleEnd - titleStart - 1);
+            size_t wordStart = 0;
+            while (wordStart < title.size()) {
+                size_t wordEnd = title.find(' ', wordStart);
+                if (wordEnd == std::string::npos) wordEnd = title.size();
+                if (wordEnd - wordStart >= 5) {
+                    words.push_back(title.substr(wordStart, wordEnd - wordStart));
+                    break;
+                }
+                wordStart = wordEnd + 1;
+            }
+        }
+    }
+    // Leave the catalog as we found it
+    for (int bookId : onLoan) {
+        if (!connection.sendLine("RETURN " + std::to_string(bookId)) || !connection.readReply("RETURN", reply)) break;
+    }
+    connection.sendLine("QUIT");
+    connection.readReply("QUIT", reply);
+}
+
+double percentile(const std::vector<double>& sorted, double fraction) {
+    if (sorted.empty()) return 0;
+    size_t index = static_cast<size_t>(fraction * (sorted.size() - 1) + 0.5);
+    return sorted[index];
+}
+
+int load(const LoadOptions& options) {
+    std::vector<LoadResult> results(options.connections);
+    std::vector<std::thread> clients;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < options.connections; ++i) {
+        clients.emplace_back(runClient, std::cref(options), i, std::ref(results[i]));
+    }
+    for (std::thread& client : clients) client.join();
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::map<std::string, std::vector<double>> latencies;
+    std::map<std::string, size_t> succeeded;
+    size_t total = 0;
+    for (const LoadResult& result : results) {
+        if (result.failed) {
+            std::cerr << "Error: A client lost its connection or could not log in" << std::endl;
+            return 1;
+        }
+        for (const auto& entry : result.latencies) {
+            auto& all = latencies[entry.first];
+            all.insert(all.end(), entry.second.begin(), entry.second.end());
+            total += entry.second.size();
+        }
+        for (const auto& entry : result.succeeded) succeeded[entry.first] += entry.second;
+    }
+
+    std::cout << options.connections << " connections, " << total << " requests in " << std::fixed
+              << std::setprecision(2) << seconds << " s: " << std::setprecision(0) << total / seconds
+              << " requests/s\n\n";
+    std::cout << std::left << std::setw(9) << "Command" << std::right << std::setw(10) << "Requests" << std::setw(10)
+              << "OK" << std::setw(10) << "p50 us" << std::setw(10) << "p95 us" << std::setw(10) << "p99 us"
+              << std::setw(10) << "max us" << "\n";
+    for (auto& entry : latencies) {
+        std::vector<double>& sorted = entry.second;
+        std::sort(sorted.begin(), sorted.end());
+        std::cout << std::left << std::setw(9) << entry.first << std::right << std::setw(10) << sorted.size()
+                  << std::setw(10) << succeeded[entry.first] << std::setprecision(0) << std::setw(10)
+                  << percentile(sorted, 0.50) << std::setw(10) << percentile(sorted, 0.95) << std::setw(10)
+                  << percentile(sorted, 0.99) << std::setw(10) << sorted.back() << "\n";
+    }
+    return 0;
+}
+
+} // namespace
+
+// lms-client [--socket PATH]
+// lms-client --load [--socket PATH] [--connections N] [--requests N]
+//                   [--user ID:PASSWORD]... [--seed N]
+int main(int argc, char** argv) {
+    LoadOptions options;
+    options.socketPath = kDefaultSocketPath;
+    bool loadMode = false;
+    for (int i = 1; i < argc; ++i) {
+        std::string option = argv[i];
+        if (option == "--load") {
+            loadMode = true;
+            continue;
+        }
+        if (i + 1 >= argc) {
+            std::cerr << "Error: Missing value for " << option << std::endl;
+            return 1;
+        }
+        std::string value = argv[++i];
+        if (option == "--socket") {
+            options.socketPath = value;
+        } else if (option == "--connections") {
+            if (!parseInt(value, options.connections) || options.connections <= 0) {
+                std::cerr << "Error: Invalid connection count: " << value << std::endl;
+                return 1;
+            }
+        } else if (option == "--requests") {
+            if (!parseInt(value, options.requests) || options.requests < 0) {
+                std::cerr << "Error: Invalid request count: " << value << std::endl;
+                return 1;
+            }
+        } else if (option == "--user") {
+            size_t colon = value.find(':');
+            if (colon == std::string::npos) {
+                std::cerr << "Error: Expected ID:PASSWORD, got " << value << std::endl;
+                return 1;
+            }
+            options.users.emplace_back(value.substr(0, colon), value.substr(colon + 1));
+        } else if (option == "--seed") {
+            int seed;
+            if (!parseInt(value, seed)) {
+                std::cerr << "Error: Invalid seed: " << value << std::endl;
+                return 1;
+            }
+            options.seed = static_cast<unsigned>(seed);
+        } else {
+            std::cerr << "Error: Unknown option " << option << std::endl;
+            return 1;
+        }
+    }
+    if (!loadMode) return interactive(options.socketPath);
+
+    if (options.users.empty()) {
+        options.users = {{"S001", "student123"}, {"S003", "student345"}, {"F001", "faculty123"}};
+    }
+    return load(options);
+}
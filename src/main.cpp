@@ -1,6 +1,14 @@
 #include "Library.h"
+#include "Simulator.h"
+#include "Script.h"
+#include "Bench.h"
+#include "FieldParser.h"
 #include <iostream>
+#include <fstream>
+#include <chrono>
 #include <limits>
+#include <algorithm>
+#include <cstdlib>
 
 void clearInputBuffer() {
     std::cin.clear();
@@ -17,11 +25,12 @@ void displayLibrarianMenu() {
     std::cout << "6. Display All Books\n";
     std::cout << "7. Display User Details\n";
     std::cout << "8. Change Password\n";
-    std::cout << "9. Logout\n";
+    std::cout << "9. Catalog Report\n";
+    std::cout << "10. Logout\n";
     std::cout << "Enter your choice: ";
 }
 
-void displayUserMenu(const std::string& role) {
+void displayUserMenu(Role role) {
     std::cout << "\nUser Menu:\n";
     std::cout << "1. View Available Books\n";
     std::cout << "2. Borrow Book\n";
@@ -30,18 +39,73 @@ void displayUserMenu(const std::string& role) {
     std::cout << "5. Reserve Book\n";
     std::cout << "6. Cancel Reservation\n";
     std::cout << "7. View My Reserved Books\n";
-    if (role != "Faculty") {
-        std::cout << "8. View My Fines\n";
-        std::cout << "9. Pay Fine\n";
-        std::cout << "10. Change Password\n";
-        std::cout << "11. Logout\n";
+    std::cout << "8. Search Books\n";
+    if (role != Role::Faculty) {
+        std::cout << "9. View My Fines\n";
+        std::cout << "10. Pay Fine\n";
+        std::cout << "11. Change Password\n";
+        std::cout << "12. Logout\n";
     } else {
-        std::cout << "8. Change Password\n";
-        std::cout << "9. Logout\n";
+        std::cout << "9. Change Password\n";
+        std::cout << "10. Logout\n";
     }
     std::cout << "Enter your choice: ";
 }
 
+void handleBookSearch(Library& lib) {
+    std::string query;
+    std::cout << "Enter an ISBN, search words (use OR between alternatives),\n"
+              << "the start of a title or author followed by *,\n"
+              << "or any text in double quotes to find it inside titles, authors and publishers: ";
+    std::getline(std::cin, query);
+
+    std::string suggestion;
+    std::vector<Book*> results = lib.findBooks(query, suggestion);
+    if (!results.empty() && !suggestion.empty()) {
+        std::cout << "Did you mean: " << suggestion << "?\n";
+    }
+    if (results.empty()) {
+        std::cout << "No matching books found.\n";
+        return;
+    }
+    // The matches are listed as the published catalog shows them
+    PublishedCatalog::Reader catalog = lib.readCatalog();
+    std::cout << "Search Results:\n";
+    for (const Book* result : results) {
+        const BookView* book = catalog.book(result->getBookId());
+        if (!book) continue;
+        std::cout << "ID: " << book->getBookId()
+                  << ", Title: " << book->getTitle()
+                  << ", Author: " << book->getAuthor()
+                  << ", Publisher: " << book->getPublisher()
+                  << ", Status: " << book->getStatus() << std::endl;
+    }
+}
+
+void handleCatalogReport(Library& lib) {
+    BookFilter filter;
+    std::string input;
+    std::cout << "Status (Available/Borrowed/Reserved, empty for any): ";
+    std::getline(std::cin, input);
+    if (!input.empty()) {
+        if (!parseBookStatus(input, filter.status)) {
+            std::cout << "Unknown status.\n";
+            return;
+        }
+        filter.anyStatus = false;
+    }
+    std::cout << "Publisher (empty for any): ";
+    std::getline(std::cin, filter.publisher);
+    std::cout << "From year (empty for any): ";
+    std::getline(std::cin, input);
+    if (!input.empty()) filter.fromYear = std::atoi(input.c_str());
+    std::cout << "To year (empty for any): ";
+    std::getline(std::cin, input);
+    if (!input.empty()) filter.toYear = std::atoi(input.c_str());
+
+    lib.displayCatalogReport(filter);
+}
+
 void handleLibrarianMenu(Library& lib, User* user) {
     int choice;
     std::string input;
@@ -233,7 +297,10 @@ void handleLibrarianMenu(Library& lib, User* user) {
                 }
                 break;
             }
-            case 9: // Logout
+            case 9: // Catalog Report
+                handleCatalogReport(lib);
+                break;
+            case 10: // Logout
                 return;
             default:
                 std::cout << "Invalid choice. Please try again.\n";
@@ -243,9 +310,12 @@ void handleLibrarianMenu(Library& lib, User* user) {
 
 void handleUserMenu(Library& lib, User* user) {
     int choice;
-    bool isFaculty = (user->getRole() == "Faculty");
+    bool isFaculty = (user->getRole() == Role::Faculty);
     
     while (true) {
+        // Charge fines that grew since the last menu
+        lib.updateFines();
+
         // Check for any available reservations
         std::vector<Book*> reservedBooks = lib.getReservedBooks(user->getUserId());
         for (Book* book : reservedBooks) {
@@ -260,7 +330,7 @@ void handleUserMenu(Library& lib, User* user) {
 
         switch (choice) {
             case 1: // View Available Books
-                lib.displayAllBooks();
+                lib.displayAvailableBooks();
                 break;
             case 2: { // Borrow Book
                 int bookId;
@@ -271,7 +341,7 @@ void handleUserMenu(Library& lib, User* user) {
                 if (lib.borrowBook(user->getUserId(), bookId)) {
                     std::cout << "Book borrowed successfully!\n";
                 } else {
-                    if (user->getRole() == "Faculty") {
+                    if (isFaculty) {
                         std::cout << "Failed to borrow book. Please return your current books first.\n";
                     } else {
                         std::cout << "Failed to borrow book.\n";
@@ -318,12 +388,15 @@ void handleUserMenu(Library& lib, User* user) {
                 break;
             }
             case 7: { // View My Reserved Books
-                std::vector<Book*> reservedBooks = lib.getReservedBooks(user->getUserId());
+                PublishedCatalog::Reader catalog = lib.readCatalog();
+                std::vector<int> reservedBooks = catalog.reservedBooks(user->getUserId());
                 if (reservedBooks.empty()) {
                     std::cout << "You have no reserved books.\n";
                 } else {
                     std::cout << "Your Reserved Books:\n";
-                    for (const Book* book : reservedBooks) {
+                    for (int bookId : reservedBooks) {
+                        const BookView* book = catalog.book(bookId);
+                        if (!book) continue;
                         std::cout << "ID: " << book->getBookId()
                                 << ", Title: " << book->getTitle()
                                 << ", Status: " << book->getStatus()
@@ -332,7 +405,10 @@ void handleUserMenu(Library& lib, User* user) {
                 }
                 break;
             }
-            case 8: {
+            case 8: // Search Books
+                handleBookSearch(lib);
+                break;
+            case 9: {
                 if (!isFaculty) { // View My Fines
                     Account* account = lib.getAccount(user->getUserId());
                     if (account) {
@@ -353,7 +429,7 @@ void handleUserMenu(Library& lib, User* user) {
                 }
                 break;
             }
-            case 9: {
+            case 10: {
                 if (!isFaculty) { // Pay Fine
                     Account* account = lib.getAccount(user->getUserId());
                     if (account && account->getTotalFine() > 0) {
@@ -374,7 +450,7 @@ void handleUserMenu(Library& lib, User* user) {
                 }
                 break;
             }
-            case 10: {
+            case 11: {
                 if (!isFaculty) { // Change Password for non-Faculty
                     std::string oldPass, newPass;
                     std::cout << "Enter old password: ";
@@ -390,7 +466,7 @@ void handleUserMenu(Library& lib, User* user) {
                 }
                 break;
             }
-            case 11: { // Logout for non-Faculty
+            case 12: { // Logout for non-Faculty
                 if (!isFaculty) {
                     return;
                 }
@@ -405,8 +481,148 @@ void handleUserMenu(Library& lib, User* user) {
     }
 }
 
-int main() {
+// lms --simulate [--days N] [--students N] [--faculty N] [--books N] [--visits R] [--seed N]
+//               [--threads N,N,...] [--operations N]
+int runSimulation(int argc, char** argv) {
+    SimulationConfig config;
+    for (int i = 2; i < argc; i += 2) {
+        std::string option = argv[i];
+        if (i + 1 >= argc) {
+            std::cerr << "Error: Missing value for " << option << std::endl;
+            return 1;
+        }
+        const char* value = argv[i + 1];
+        if (option == "--days") config.days = atoi(value);
+        else if (option == "--students") config.students = atoi(value);
+        else if (option == "--faculty") config.faculty = atoi(value);
+        else if (option == "--books") config.books = atoi(value);
+        else if (option == "--visits") config.visitsPerDay = atof(value);
+        else if (option == "--seed") config.seed = static_cast<unsigned>(atoi(value));
+        else if (option == "--operations") config.operations = atoi(value);
+        else if (option == "--threads") {
+            FieldReader counts(value);
+            std::string_view count;
+            while (counts.next(count, ',')) config.threadCounts.push_back(atoi(std::string(count).c_str()));
+        }
+        else {
+            std::cerr << "Error: Unknown simulation option " << option << std::endl;
+            return 1;
+        }
+    }
+    if (config.days <= 0 || config.books <= 0 || config.students < 0 || config.faculty < 0 ||
+        config.visitsPerDay <= 0 || config.operations <= 0 ||
+        std::any_of(config.threadCounts.begin(), config.threadCounts.end(), [](int n) { return n <= 0; })) {
+        std::cerr << "Error: Simulation sizes and rates must be positive" << std::endl;
+        return 1;
+    }
+    Simulator(config).run(std::cout);
+    return 0;
+}
+
+// lms --script FILE|- [--data DIR] [--commit-every N]
+int runScript(int argc, char** argv) {
+    if (argc < 3) {
+        std::cerr << "Error: --script needs a file, or - for standard input" << std::endl;
+        return 1;
+    }
+    std::string path = argv[2];
+    std::string dataDir = "data";
+    int commitEvery = 0;
+    for (int i = 3; i < argc; i += 2) {
+        std::string option = argv[i];
+        if (i + 1 >= argc) {
+            std::cerr << "Error: Missing value for " << option << std::endl;
+            return 1;
+        }
+        if (option == "--data") {
+            dataDir = argv[i + 1];
+        } else if (option == "--commit-every") {
+            if (!parseInt(argv[i + 1], commitEvery) || commitEvery <= 0) {
+                std::cerr << "Error: --commit-every needs a positive count" << std::endl;
+                return 1;
+            }
+        } else {
+            std::cerr << "Error: Unknown script option " << option << std::endl;
+            return 1;
+        }
+    }
+    std::ifstream file;
+    if (path != "-") {
+        file.open(path);
+        if (!file) {
+            std::cerr << "Error: Cannot open script " << path << std::endl;
+            return 1;
+        }
+    }
+
+    // Everything printed, the library's messages included, goes out in
+    // large blocks instead of a write per std::endl
+    std::ios::sync_with_stdio(false);
+    std::cin.tie(nullptr);
+    BufferedOutput buffered(std::cout.rdbuf());
+    std::streambuf* console = std::cout.rdbuf(&buffered);
+    bool ok;
+    {
+        Library lib(dataDir);
+        if (commitEvery > 0) lib.setCommitPolicy(CommitPolicy::EveryNOperations, commitEvery);
+        ScriptRunner runner(lib, std::cout);
+        auto started = std::chrono::steady_clock::now();
+        ok = runner.run(path == "-" ? std::cin : file);
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+        buffered.drain();
+        runner.report(std::cerr, seconds);
+    }
+    std::cout.rdbuf(console);
+    buffered.drain();
+    return ok ? 0 : 1;
+}
+
+// lms --bench [SUITE...] [--rows N] [--repeat N] [--seed N]
+int runBench(int argc, char** argv) {
+    BenchConfig config;
+    for (int i = 2; i < argc; ++i) {
+        std::string option = argv[i];
+        if (option.compare(0, 2, "--") != 0) {
+            config.suites.push_back(option);
+            continue;
+        }
+        if (i + 1 >= argc) {
+            std::cerr << "Error: Missing value for " << option << std::endl;
+            return 1;
+        }
+        int value;
+        if (!parseInt(argv[++i], value) || value <= 0) {
+            std::cerr << "Error: " << option << " needs a positive number" << std::endl;
+            return 1;
+        }
+        if (option == "--rows") config.rows = value;
+        else if (option == "--repeat") config.repeat = value;
+        else if (option == "--seed") config.seed = static_cast<unsigned>(value);
+        else {
+            std::cerr << "Error: Unknown benchmark option " << option << std::endl;
+            return 1;
+        }
+    }
+    return Bench(config).run(std::cout) ? 0 : 1;
+}
+
+int main(int argc, char** argv) {
+    if (argc > 1 && std::string(argv[1]) == "--simulate") {
+        return runSimulation(argc, argv);
+    }
+    if (argc > 1 && std::string(argv[1]) == "--script") {
+        return runScript(argc, argv);
+    }
+    if (argc > 1 && std::string(argv[1]) == "--bench") {
+        return runBench(argc, argv);
+    }
+
     Library lib;
+
+    if (argc > 1 && std::string(argv[1]) == "--memory-report") {
+        lib.printMemoryReport(std::cout);
+        return 0;
+    }
     std::string userId, password;
 
     while (true) {
@@ -430,7 +646,7 @@ int main() {
             User* user = lib.authenticateUser(userId, password);
             if (user) {
                 std::cout << "Welcome, " << user->getName() << "!\n";
-                if (user->getRole() == "Librarian") {
+                if (user->getRole() == Role::Librarian) {
                     handleLibrarianMenu(lib, user);
                 } else {
                     handleUserMenu(lib, user);
@@ -0,0 +1,462 @@
+#include "Library.h"
+#include "Protocol.h"
+#include "FieldParser.h"
+#include <iostream>
+#include <sstream>
+#include <iomanip>
+#include <unordered_map>
+#include <vector>
+#include <memory>
+#include <chrono>
+#include <cerrno>
+#include <cstring>
+#include <csignal>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace {
+
+volatile sig_atomic_t stopRequested = 0;
+
+void requestStop(int) {
+    stopRequested = 1;
+}
+
+// One client and its session
+struct Connection {
+    int fd;
+    std::string input;       // received bytes not yet executed
+    std::string output;      // replies not yet written
+    size_t written = 0;      // bytes of `output` already sent
+    std::string userId;      // empty until AUTH succeeds
+    bool hangUp = false;     // close once the replies are out
+    bool readClosed = false; // the client sent EOF; only replies are left
+    bool watchingWrites = false;
+    bool awaitingCommit = false;
+
+    explicit Connection(int fd) : fd(fd) {}
+};
+
+std::string formatBook(const BookView& book) {
+    std::string line = std::to_string(book.getBookId());
+    for (std::string_view field : {book.getTitle(), book.getAuthor(), book.getPublisher()}) {
+        line += '|';
+        line += field;
+    }
+    line += '|';
+    line += std::to_string(book.getYear());
+    line += '|';
+    line += book.getIsbn();
+    line += '|';
+    line += book.getStatus();
+    line += '|';
+    line += book.getBorrowedBy().empty() ? "None" : book.getBorrowedBy();
+    return line;
+}
+
+std::string formatAmount(double amount) {
+    std::ostringstream out;
+    out << std::fixed << std::setprecision(2) << amount;
+    return out.str();
+}
+
+// Serves every client from one Library on a single thread. Each pass of the
+// event loop executes all the complete requests that arrived, commits the
+// journal once, and only then writes the replies, so one fsync covers every
+// change made in the pass.
+class Server {
+private:
+    Library& lib;
+    std::string socketPath;
+    int listener;
+    int epoll;
+    std::unordered_map<int, std::unique_ptr<Connection>> connections;
+    std::vector<int> awaitingCommit;  // connections whose replies wait for the commit
+    std::stringbuf console;           // what the library printed during a request
+
+    static constexpr int kMaxEvents = 256;
+    static constexpr int kSweepMilliseconds = 1000;
+    static constexpr uint64_t kCheckpointJournalBytes = 32 << 20;
+
+    void acceptClients();
+    void receive(Connection& connection);
+    void execute(Connection& connection, std::string_view request);
+    std::string dispatch(Connection& connection, std::string_view command, std::string_view argument);
+    std::string failure(const char* fallback) const;
+    void commitAndReply();
+    void send(Connection& connection);
+    void watchWrites(Connection& connection, bool watch);
+    void updateEvents(const Connection& connection);
+    void close(int fd);
+    void sweep();
+
+public:
+    explicit Server(Library& lib) : lib(lib), listener(-1), epoll(-1) {}
+    ~Server();
+
+    bool listen(const std::string& path);
+    void run();
+};
+
+Server::~Server() {
+    for (auto& entry : connections) ::close(entry.first);
+    if (epoll >= 0) ::close(epoll);
+    if (listener >= 0) {
+        ::close(listener);
+        unlink(socketPath.c_str());
+    }
+}
+
+bool Server::listen(const std::string& path) {
+    sockaddr_un address;
+    std::memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(address.sun_path)) {
+        std::cerr << "Error: Socket path is too long: " << path << std::endl;
+        return false;
+    }
+    std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+
+    listener = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (listener < 0) {
+        std::cerr << "Error: Cannot create socket: " << std::strerror(errno) << std::endl;
+        return false;
+    }
+    // A socket file left by a server that did not exit cleanly
+    unlink(path.c_str());
+    if (bind(listener, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0 ||
+        ::listen(listener, SOMAXCONN) < 0) {
+        std::cerr << "Error: Cannot listen on " << path << ": " << std::strerror(errno) << std::endl;
+        ::close(listener);
+        listener = -1;
+        return false;
+    }
+    socketPath = path;
+
+    epoll = epoll_create1(EPOLL_CLOEXEC);
+    epoll_event event;
+    event.events = EPOLLIN;
+    event.data.fd = listener;
+    if (epoll < 0 || epoll_ctl(epoll, EPOLL_CTL_ADD, listener, &event) < 0) {
+        std::cerr << "Error: Cannot set up epoll: " << std::strerror(errno) << std::endl;
+        return false;
+    }
+    return true;
+}
+
+void Server::run() {
+    epoll_event events[kMaxEvents];
+    auto lastSweep = std::chrono::steady_clock::now();
+    while (!stopRequested) {
+        int count = epoll_wait(epoll, events, kMaxEvents, kSweepMilliseconds);
+        if (count < 0 && errno != EINTR) {
+            std::cerr << "Error: epoll_wait failed: " << std::strerror(errno) << std::endl;
+            break;
+        }
+        for (int i = 0; i < count; ++i) {
+            int fd = events[i].data.fd;
+            if (fd == listener) {
+                acceptClients();
+                continue;
+            }
+            auto it = connections.find(fd);
+            if (it == connections.end()) continue;
+            if (events[i].events & EPOLLOUT) {
+                // send() closes a connection that is finished or broken
+                send(*it->second);
+                it = connections.find(fd);
+                if (it == connections.end()) continue;
+            }
+            if (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR)) receive(*it->second);
+        }
+
+        // What the menu runs between screens, at most once a second
+        auto now = std::chrono::steady_clock::now();
+        if (now - lastSweep >= std::chrono::milliseconds(kSweepMilliseconds)) {
+            sweep();
+            lastSweep = now;
+        }
+        commitAndReply();
+    }
+}
+
+void Server::acceptClients() {
+    while (true) {
+        int fd = accept4(listener, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) {
+            if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+                std::cerr << "Error: accept failed: " << std::strerror(errno) << std::endl;
+            }
+            return;
+        }
+        epoll_event event;
+        event.events = EPOLLIN;
+        event.data.fd = fd;
+        if (epoll_ctl(epoll, EPOLL_CTL_ADD, fd, &event) < 0) {
+            ::close(fd);
+            continue;
+        }
+        connections[fd].reset(new Connection(fd));
+    }
+}
+
+// Reads what has arrived and executes every complete line. A client that
+// sent EOF may only have shut down its own side, so it is closed once the
+// replies to the requests it sent are committed and written.
+void Server::receive(Connection& connection) {
+    char buffer[16384];
+    bool closed = false;
+    while (!connection.readClosed) {
+        ssize_t n = recv(connection.fd, buffer, sizeof(buffer), 0);
+        if (n > 0) {
+            connection.input.append(buffer, static_cast<size_t>(n));
+            if (static_cast<size_t>(n) < sizeof(buffer)) break;
+        } else if (n == 0) {
+            closed = true;
+            break;
+        } else {
+            if (errno == EINTR) continue;
+            if (errno != EAGAIN && errno != EWOULDBLOCK) closed = true;
+            break;
+        }
+    }
+
+    size_t start = 0;
+    size_t end;
+    while (!connection.hangUp && (end = connection.input.find('\n', start)) != std::string::npos) {
+        std::string_view request(connection.input.data() + start, end - start);
+        if (!request.empty() && request.back() == '\r') request.remove_suffix(1);
+        execute(connection, request);
+        start = end + 1;
+    }
+    connection.input.erase(0, start);
+    if (connection.input.size() > kMaxRequestLength) {
+        connection.output += "ERR request too long\n";
+        connection.hangUp = true;
+        connection.input.clear();
+    }
+    if (!connection.awaitingCommit && connection.written < connection.output.size()) {
+        connection.awaitingCommit = true;
+        awaitingCommit.push_back(connection.fd);
+    }
+    if (closed && !connection.readClosed) {
+        connection.hangUp = true;
+        connection.readClosed = true;
+        updateEvents(connection);
+    }
+    if (connection.readClosed && !connection.awaitingCommit && connection.written >= connection.output.size()) {
+        close(connection.fd);
+    }
+}
+
+void Server::execute(Connection& connection, std::string_view request) {
+    std::string_view command, argument;
+    splitRequest(request, command, argument);
+    if (command.empty()) return;
+
+    // The library reports to the console; keep it as the reason for failures
+    console.str(std::string());
+    std::streambuf* saved = std::cout.rdbuf(&console);
+    std::string reply = dispatch(connection, command, argument);
+    std::cout.rdbuf(saved);
+    connection.output += reply;
+}
+
+// The last thing the library printed, or `fallback` if it printed nothing
+std::string Server::failure(const char* fallback) const {
+    std::string printed = console.str();
+    while (!printed.empty() && (printed.back() == '\n' || printed.back() == ' ')) printed.pop_back();
+    size_t lineStart = printed.rfind('\n');
+    std::string reason = lineStart == std::string::npos ? printed : printed.substr(lineStart + 1);
+    const std::string prefix = "Error: ";
+    if (reason.compare(0, prefix.size(), prefix) == 0) reason.erase(0, prefix.size());
+    return "ERR " + (reason.empty() ? std::string(fallback) : reason) + "\n";
+}
+
+std::string Server::dispatch(Connection& connection, std::string_view command, std::string_view argument) {
+    if (command == "AUTH") {
+        std::string_view userId, password;
+        splitRequest(argument, userId, password);
+        User* user = lib.authenticateUser(std::string(userId), std::string(password));
+        if (!user) return "ERR invalid user id or password\n";
+        connection.userId = user->getUserId();
+        return "OK " + std::string(user->getRoleName()) + " " + user->getName() + "\n";
+    }
+    if (command == "BOOK") {
+        int bookId;
+        if (!parseInt(argument, bookId)) return "ERR expected a book id\n";
+        PublishedCatalog::Reader catalog = lib.readCatalog();
+        const BookView* book = catalog.book(bookId);
+        if (!book) return "ERR no such book\n";
+        return "OK " + formatBook(*book) + "\n";
+    }
+    if (command == "SEARCH") {
+        std::string suggestion;
+        std::vector<Book*> results = lib.findBooks(std::string(argument), suggestion);
+        PublishedCatalog::Reader catalog = lib.readCatalog();
+        std::string lines;
+        size_t found = 0;
+        for (const Book* result : results) {
+            const BookView* book = catalog.book(result->getBookId());
+            if (!book) continue;
+            lines += formatBook(*book);
+            lines += '\n';
+            ++found;
+        }
+        return "OK " + std::to_string(found) + "\n" + lines;
+    }
+    if (command == "INFO") {
+        PublishedCatalog::Reader catalog = lib.readCatalog();
+        return "OK " + std::to_string(catalog.size()) + " " + std::to_string(lib.getAllUsers().size()) + " " +
+               std::to_string(catalog.version()) + "\n";
+    }
+    if (command == "QUIT") {
+        connection.hangUp = true;
+        return "OK\n";
+    }
+
+    // The rest act for the logged-in user
+    if (command != "BORROW" && command != "RETURN" && command != "RESERVE" && command != "CANCEL" &&
+        command != "PAY" && command != "FINE") {
+        return "ERR unknown command\n";
+    }
+    if (connection.userId.empty()) return "ERR log in with AUTH first\n";
+    const std::string& userId = connection.userId;
+
+    if (command == "FINE" || command == "PAY") {
+        Account* account = lib.getAccount(userId);
+        if (!account) return "ERR no account\n";
+        if (command == "FINE") return "OK " + formatAmount(account->getTotalFine()) + "\n";
+        double amount;
+        if (!parseDouble(argument, amount) || amount <= 0) return "ERR expected a positive amount\n";
+        if (account->getTotalFine() <= 0) return "ERR no fines to pay\n";
+        lib.payFine(userId, amount);
+        return "OK " + formatAmount(account->getTotalFine()) + "\n";
+    }
+
+    int bookId;
+    if (!parseInt(argument, bookId)) return "ERR expected a book id\n";
+    if (command == "BORROW") {
+        return lib.borrowBook(userId, bookId) ? "OK\n" : failure("cannot borrow this book");
+    }
+    if (command == "RETURN") {
+        return lib.returnBook(userId, bookId) ? "OK\n" : failure("this book is not on loan to you");
+    }
+    if (command == "RESERVE") {
+        return lib.reserveBook(userId, bookId) ? "OK\n" : failure("cannot reserve this book");
+    }
+    return lib.cancelReservation(userId, bookId) ? "OK\n" : failure("no reservation found");
+}
+
+// One commit for everything the pass changed, then the replies. If the
+// commit fails the replies are held and the commit is retried next pass.
+void Server::commitAndReply() {
+    if (awaitingCommit.empty()) return;
+    if (!lib.flush()) return;
+    std::vector<int> ready;
+    ready.swap(awaitingCommit);
+    for (int fd : ready) {
+        auto it = connections.find(fd);
+        if (it == connections.end()) continue;
+        it->second->awaitingCommit = false;
+        send(*it->second);
+    }
+}
+
+// Writes as much of the pending output as the socket takes, watching for
+// writability while some is left
+void Server::send(Connection& connection) {
+    while (connection.written < connection.output.size()) {
+        ssize_t n = ::send(connection.fd, connection.output.data() + connection.written,
+                           connection.output.size() - connection.written, MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                watchWrites(connection, true);
+                return;
+            }
+            close(connection.fd);
+            return;
+        }
+        connection.written += static_cast<size_t>(n);
+    }
+    connection.output.clear();
+    connection.written = 0;
+    watchWrites(connection, false);
+    if (connection.hangUp) close(connection.fd);
+}
+
+void Server::watchWrites(Connection& connection, bool watch) {
+    if (connection.watchingWrites == watch) return;
+    connection.watchingWrites = watch;
+    updateEvents(connection);
+}
+
+// Stops watching for input after EOF, which would otherwise be reported
+// on every pass until the connection is closed
+void Server::updateEvents(const Connection& connection) {
+    epoll_event event;
+    event.events = (connection.readClosed ? 0u : static_cast<uint32_t>(EPOLLIN)) |
+                   (connection.watchingWrites ? static_cast<uint32_t>(EPOLLOUT) : 0u);
+    event.data.fd = connection.fd;
+    epoll_ctl(epoll, EPOLL_CTL_MOD, connection.fd, &event);
+}
+
+void Server::close(int fd) {
+    epoll_ctl(epoll, EPOLL_CTL_DEL, fd, nullptr);
+    ::close(fd);
+    connections.erase(fd);
+}
+
+void Server::sweep() {
+    std::streambuf* saved = std::cout.rdbuf(&console);
+    lib.updateFines();
+    lib.checkAndUpdateReservations();
+    std::cout.rdbuf(saved);
+    console.str(std::string());
+    lib.flush();
+    lib.checkpointIfJournalExceeds(kCheckpointJournalBytes);
+}
+
+} // namespace
+
+// lms-server [--socket PATH] [--data DIR]
+int main(int argc, char** argv) {
+    std::string socketPath = kDefaultSocketPath;
+    std::string dataDir = "data";
+    for (int i = 1; i < argc; i += 2) {
+        std::string option = argv[i];
+        if (i + 1 >= argc) {
+            std::cerr << "Error: Missing value for " << option << std::endl;
+            return 1;
+        }
+        if (option == "--socket") socketPath = argv[i + 1];
+        else if (option == "--data") dataDir = argv[i + 1];
+        else {
+            std::cerr << "Error: Unknown option " << option << std::endl;
+            return 1;
+        }
+    }
+
+    struct sigaction action;
+    std::memset(&action, 0, sizeof(action));
+    action.sa_handler = requestStop;
+    sigaction(SIGINT, &action, nullptr);
+    sigaction(SIGTERM, &action, nullptr);
+    signal(SIGPIPE, SIG_IGN);
+
+    Library lib(dataDir);
+    // The event loop commits once per pass
+    lib.setCommitPolicy(CommitPolicy::EveryNOperations, SIZE_MAX);
+    {
+        Server server(lib);
+        if (!server.listen(socketPath)) return 1;
+        std::cout << "Listening on " << socketPath << std::endl;
+        server.run();
+    }
+    std::cout << "Shutting down." << std::endl;
+    return 0;
+}